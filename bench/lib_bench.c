@@ -0,0 +1,275 @@
+/*
+ * lib_bench.c - host benchmarks for the lib/ data structures
+ *
+ * Each benchmark repeats an operation many times and prints one line of
+ *   BENCH name=<name> ops=<n> ns_per_op=<n>
+ * so tools/benchmark_compare -f ns_per_op can compare two builds. Pass
+ * names to run only the benchmarks starting with them, e.g.
+ * `./lib_bench.a heap jmemcpy`
+ */
+
+#include <alloc.h>
+#include <cbuffer.h>
+#include <heap.h>
+#include <jstring.h>
+#include <map.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <util.h>
+
+// track nodes, and MAX_TASKS on x86 and ARM
+#define LOAD_TRACK 144
+#define LOAD_TASKS_X86 256
+#define LOAD_TASKS_ARM 2048
+
+#define BENCH_OPS 1000000
+#define MAP_KEYS 128
+#define ALLOC_BATCH 64
+#define COPY_MAX 4096
+
+static int bench_argc;
+static char **bench_argv;
+
+// results are written here, so nothing is optimized away
+static volatile void *sink;
+static volatile int isink;
+
+static long long now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static bool should_run(const char *name) {
+  if (bench_argc <= 1) return true;
+  for (int i = 1; i < bench_argc; i++) {
+    if (strncmp(name, bench_argv[i], strlen(bench_argv[i])) == 0) return true;
+  }
+  return false;
+}
+
+static void report(const char *name, long long ops, long long elapsed_ns) {
+  printf("BENCH name=%s ops=%lld ns_per_op=%.2f\n", name, ops, (double) elapsed_ns / ops);
+}
+
+/*
+ * cbuffer
+ */
+
+static void bench_cbuffer(const char *name, int size) {
+  if (!should_run(name)) return;
+  void *buffer[LOAD_TASKS_ARM];
+  cbuffer_t cbuffer;
+  cbuffer_init(&cbuffer, buffer, size);
+  int rounds = BENCH_OPS / size;
+
+  long long start = now_ns();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < size; i++) {
+      cbuffer_add(&cbuffer, (void *) (long) i);
+    }
+    for (int i = 0; i < size; i++) {
+      sink = cbuffer_pop(&cbuffer, NULL);
+    }
+  }
+  // an add and a pop per item
+  report(name, (long long) rounds * size, now_ns() - start);
+}
+
+/*
+ * heap
+ */
+
+static int heap_increments[BENCH_OPS];
+
+// Pops the top and pushes it back behind the others, at a steady size
+static void bench_heap(const char *name, int size) {
+  if (!should_run(name)) return;
+  heapnode_t nodes[LOAD_TASKS_ARM];
+  heap_t heap = heap_create(nodes, size);
+  srand(size);
+  for (int i = 0; i < size; i++) {
+    heap_push(&heap, rand() % 1000, NULL);
+  }
+  // rand() takes about as long as the heap ops, so it isn't timed
+  for (int i = 0; i < BENCH_OPS; i++) {
+    heap_increments[i] = rand() % 1000;
+  }
+
+  long long start = now_ns();
+  for (int i = 0; i < BENCH_OPS; i++) {
+    int priority = heap_peek_priority(&heap);
+    sink = heap_pop(&heap);
+    heap_push(&heap, priority + heap_increments[i], NULL);
+  }
+  report(name, BENCH_OPS, now_ns() - start);
+}
+
+/*
+ * map
+ */
+
+static char map_keys[MAP_KEYS][16];
+
+static void bench_map() {
+  map_val_t buffer[MAP_KEYS * 2];
+  map_t map;
+  int rounds = BENCH_OPS / MAP_KEYS;
+  for (int i = 0; i < MAP_KEYS; i++) {
+    jformatf(map_keys[i], sizeof(map_keys[i]), "key_%d", i);
+  }
+
+  if (should_run("map_insert")) {
+    long long start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+      map_init(&map, buffer, MAP_KEYS * 2);
+      for (int i = 0; i < MAP_KEYS; i++) {
+        map_insert(&map, map_keys[i], map_keys[i]);
+      }
+    }
+    report("map_insert", (long long) rounds * MAP_KEYS, now_ns() - start);
+  }
+
+  if (should_run("map_get")) {
+    map_init(&map, buffer, MAP_KEYS * 2);
+    for (int i = 0; i < MAP_KEYS; i++) {
+      map_insert(&map, map_keys[i], map_keys[i]);
+    }
+    long long start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < MAP_KEYS; i++) {
+        sink = map_get(&map, map_keys[i]);
+      }
+    }
+    report("map_get", (long long) rounds * MAP_KEYS, now_ns() - start);
+  }
+}
+
+/*
+ * alloc
+ */
+
+// Allocates a batch of sizes in turn, then frees them all
+static void bench_alloc(const char *name, const unsigned int *sizes, int num_sizes) {
+  if (!should_run(name)) return;
+  void *ptrs[ALLOC_BATCH];
+  int rounds = BENCH_OPS / ALLOC_BATCH;
+  long long ops = 0;
+  long long elapsed = 0;
+  allocator_init();
+
+  for (int r = 0; r < rounds; r++) {
+    long long start = now_ns();
+    int count = 0;
+    for (; count < ALLOC_BATCH; count++) {
+      ptrs[count] = alloc(sizes[count % num_sizes]);
+      if (ptrs[count] == NULL) break;
+    }
+    for (int i = 0; i < count; i++) {
+      jfree(ptrs[i]);
+    }
+    elapsed += now_ns() - start;
+    ops += count;
+    // sizes that can't be reused run out of memory
+    if (count < ALLOC_BATCH) allocator_init();
+  }
+  // an alloc and a jfree per op
+  report(name, ops, elapsed);
+}
+
+static const unsigned int alloc_same[] = { 64 };
+static const unsigned int alloc_mixed[] = { 8, 16, 24, 64, 100, 256, 512, 1000 };
+static const unsigned int alloc_large[] = { 2048, 4096 };
+
+/*
+ * jformat
+ */
+
+static void bench_jformat(const char *name, int n) {
+  if (!should_run(name)) return;
+  // formats like the logs and terminal output
+  char buf[256];
+  long long start = now_ns();
+  for (int i = 0; i < BENCH_OPS / 4; i++) {
+    switch (n) {
+    case 0:
+      jformatf(buf, sizeof(buf), "Send tid=%d to=%d len=%d", i, 42, 64);
+      break;
+    case 1:
+      jformatf(buf, sizeof(buf), "Train %d at %s offset=%dmm velocity=%d", 58, "C13", i, 512);
+      break;
+    case 2:
+      jformatf(buf, sizeof(buf), "pc=%x lr=%x sp=%x", i, 0x218000, 0x1FFFFC);
+      break;
+    }
+    isink = buf[0];
+  }
+  report(name, BENCH_OPS / 4, now_ns() - start);
+}
+
+/*
+ * jmemcpy and jmemmove
+ */
+
+static char copy_src[COPY_MAX + 512] __attribute__ ((aligned (256)));
+static char copy_dest[COPY_MAX + 512] __attribute__ ((aligned (256)));
+
+static void bench_copy(bool move, unsigned int size, int src_offset, int dest_offset) {
+  char name[64];
+  jformatf(name, sizeof(name), "%s_%d_src%d_dest%d", move ? "jmemmove" : "jmemcpy", size, src_offset, dest_offset);
+  if (!should_run(name)) return;
+  char *src = copy_src + src_offset;
+  char *dest = copy_dest + dest_offset;
+  // copy about the same number of bytes for every size
+  long long ops = (64LL * BENCH_OPS) / (size + 64);
+
+  long long start = now_ns();
+  for (long long i = 0; i < ops; i++) {
+    if (move) {
+      jmemmove(dest, src, size);
+    } else {
+      jmemcpy(dest, src, size);
+    }
+    isink = dest[0];
+  }
+  report(name, ops, now_ns() - start);
+}
+
+// offsets from a 256 byte boundary, word aligned, and not
+static const int copy_offsets[][2] = { {0, 0}, {4, 4}, {1, 3} };
+static const unsigned int copy_sizes[] = { 4, 16, 64, 256, 1024, COPY_MAX };
+
+int main(int argc, char **argv) {
+  bench_argc = argc;
+  bench_argv = argv;
+
+  bench_cbuffer("cbuffer_1", 1);
+  bench_cbuffer("cbuffer_256", LOAD_TASKS_X86);
+  bench_cbuffer("cbuffer_2048", LOAD_TASKS_ARM);
+
+  bench_heap("heap_144", LOAD_TRACK);
+  bench_heap("heap_256", LOAD_TASKS_X86);
+  bench_heap("heap_2048", LOAD_TASKS_ARM);
+
+  bench_map();
+
+  bench_alloc("alloc_same", alloc_same, sizeof(alloc_same) / sizeof(alloc_same[0]));
+  bench_alloc("alloc_mixed", alloc_mixed, sizeof(alloc_mixed) / sizeof(alloc_mixed[0]));
+  bench_alloc("alloc_large", alloc_large, sizeof(alloc_large) / sizeof(alloc_large[0]));
+
+  bench_jformat("jformat_send", 0);
+  bench_jformat("jformat_train", 1);
+  bench_jformat("jformat_hex", 2);
+
+  for (int move = 0; move <= 1; move++) {
+    for (int s = 0; s < sizeof(copy_sizes) / sizeof(copy_sizes[0]); s++) {
+      for (int o = 0; o < sizeof(copy_offsets) / sizeof(copy_offsets[0]); o++) {
+        bench_copy(move, copy_sizes[s], copy_offsets[o][0], copy_offsets[o][1]);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * Input capture, for replaying a session
+ *
+ * Records every byte read from UART1 and UART2, and every timer tick, with
+ * the time since the previous event. Events are varints of
+ * (microseconds since the previous event << 2 | type), followed by the byte
+ * for UART events, so a tick is 3 bytes and a byte is 4 at most.
+ *
+ * On ARM capturing is turned on with INPUT_CAPTURE in debug.h, and the
+ * capture is dumped as hex over COM2 on exit, tools/capture_extract turns it
+ * back into binary. On x86 LOCAL_CAPTURE=<file> writes the binary to a
+ * file, and LOCAL_REPLAY=<file> feeds one back through the simulated
+ * devices in place of the timer, keyboard and COM1, see lib/x86/devices.c
+ */
+
+// Bytes of capture kept, recording stops once it's full
+#define CAPTURE_SIZE (256 * 1024)
+
+// Event types
+#define CAPTURE_TICK 0
+#define CAPTURE_UART1_RX 1
+#define CAPTURE_UART2_RX 2
+
+typedef struct {
+  int type;
+  // microseconds since the previous event
+  unsigned int delta_us;
+  // only for CAPTURE_UART*_RX
+  char c;
+} capture_event_t;
+
+extern char capture_buffer[CAPTURE_SIZE];
+extern unsigned int capture_length;
+// events not recorded since the buffer was full
+extern unsigned int capture_dropped;
+extern bool capture_enabled;
+
+/**
+ * Starts capturing if it's turned on, see above (arch specific)
+ */
+void capture_init();
+
+/**
+ * Clears the capture and starts timing events from now, used by
+ * capture_init
+ * @param enabled whether to record events
+ */
+void capture_start(bool enabled);
+
+/**
+ * Records an event if capturing. Only called from the kernel interrupt
+ * handlers, so events are never interleaved
+ * @param type CAPTURE_*
+ * @param c    byte received, ignored for CAPTURE_TICK
+ */
+void capture_record(int type, char c);
+
+/**
+ * Outputs the capture if capturing (arch specific)
+ */
+void capture_dump();
+
+/**
+ * Decodes the next event in a capture
+ * @param  data  of a capture
+ * @param  len   of the capture
+ * @param  pos   to decode at, moved past the event (INPUT/OUTPUT)
+ * @param  event decoded (OUTPUT)
+ * @return       0 => OK
+ *               -1 => no more events, or the last one was cut off
+ */
+int capture_decode(const char *data, unsigned int len, unsigned int *pos, capture_event_t *event);
@@ -8,6 +8,11 @@ void cleanup(bool should_print_backtraces);
 void exit_kernel();
 
 
+// Gets a function name from its starting pc, poked in by -mpoke-function-name
+// (only on ARM), returns name_not_found if there is no name
+char *get_func_name(unsigned int *pc);
+extern char *name_not_found;
+
 // Prints the stack trace, following memory (only on ARM)
 void print_stack_trace(unsigned int fp, int lr);
 
@@ -35,6 +40,24 @@ void PrintAllTaskStacks(int focused_task);
   #define NONTERMINAL_OUTPUT false
 #endif
 
+// Record kernel events into the trace ring, see kern/trace.h. The ring is
+// dumped on every exit, so it is off unless a build asks for it, e.g.
+// make KERNEL_TRACE=true
+#ifndef KERNEL_TRACE
+#define KERNEL_TRACE false
+#endif
+
+// Record input bytes and timer ticks for replaying on x86, see capture.h
+// (x86 uses LOCAL_CAPTURE instead)
+#define INPUT_CAPTURE false
+
+// Sample task program counters on every tick, see kern/profile.h. Each
+// sample adds a scan for the function start to the timer interrupt, so it
+// is off unless a build asks for it, e.g. make KERNEL_PROFILE=true
+#ifndef KERNEL_PROFILE
+#define KERNEL_PROFILE false
+#endif
+
 #define DEBUG_LOGGING_ARM true
 #define DEBUG_LOGGING_X86 true
 // Enable various log_debug statements in the code
@@ -13,6 +13,10 @@ void destroy_test_task();
 void reservoir_test_task();
 void worker_test_task();
 void attribution_test_task();
+void scenario_entry_task();
+void tid_reuse_test_task();
+void ipc_load_entry_task();
+void route_bench_entry_task();
 
 
 #if defined(USE_K1)
@@ -41,6 +45,14 @@ void attribution_test_task();
 #define ENTRY_FUNC worker_test_task
 #elif defined(USE_ATTRIBUTION_TEST)
 #define ENTRY_FUNC attribution_test_task
+#elif defined(USE_SCENARIO)
+#define ENTRY_FUNC scenario_entry_task
+#elif defined(USE_TID_REUSE_TEST)
+#define ENTRY_FUNC tid_reuse_test_task
+#elif defined(USE_IPC_LOAD)
+#define ENTRY_FUNC ipc_load_entry_task
+#elif defined(USE_ROUTE_BENCH)
+#define ENTRY_FUNC route_bench_entry_task
 #else
 #error Bad PROJECT value provided to Makefile. Expected "K1-4", "TC1", "BENCHMARK", "CLOCK_SERVER_TEST", "NAVIGATION_TEST"
 #endif
@@ -0,0 +1,35 @@
+#pragma once
+
+/*
+ * Log2 histogram of unsigned values, e.g. timings. Bucket 0 has the zeros,
+ * and bucket i has values in [2^(i-1), 2^i), so percentiles are only known
+ * to within a factor of 2. The exact min and max are kept as well.
+ */
+
+#define HISTOGRAM_BUCKETS 33
+
+typedef struct {
+  unsigned int count;
+  unsigned int min;
+  unsigned int max;
+  // wraps if the values add up to more than 32 bits
+  unsigned int total;
+  unsigned int buckets[HISTOGRAM_BUCKETS];
+} histogram_t;
+
+void histogram_init(histogram_t *histogram);
+
+void histogram_add(histogram_t *histogram, unsigned int value);
+
+/**
+ * Adds every value of another histogram
+ */
+void histogram_merge(histogram_t *histogram, const histogram_t *other);
+
+/**
+ * Estimates a percentile, as the top of the bucket it falls in, clamped to
+ * the min and max so 0 and 1000 are exact
+ * @param  permille of the values which are at most the result, 0 - 1000
+ * @return          the estimate, or 0 if the histogram is empty
+ */
+unsigned int histogram_percentile(const histogram_t *histogram, int permille);
@@ -41,6 +41,17 @@ unsigned int io_time_difference_ms(io_time_t current, io_time_t previous);
  */
 unsigned int io_time_difference_us(io_time_t current, io_time_t previous);
 
+/**
+ * Converts a millisecond duration into timing value units
+ */
+io_time_t io_time_from_ms(unsigned int ms);
+
+/**
+ * Gets the time since TIMER2 last fired, for timing how long its interrupt
+ * takes to reach a task (arch specific)
+ */
+io_time_t io_time_since_tick();
+
 /**
  * Checks if the channel is ready to put a char
  * @return         status
@@ -76,3 +87,61 @@ int io_putc(int channel, char c);
  *                 -2 => ERROR: invalid channel
  */
 int io_getc(int channel);
+
+#ifdef DEBUG_MODE
+/*
+ * Simulated devices (x86)
+ *
+ * The timer and UARTs are simulated behind the registers VMEM accesses, so
+ * the kernel handles them through the same hwi path as on the board. The
+ * kernel runs the devices with io_devices_poll between tasks, which raises
+ * the VIC status for any interrupt that the hardware would raise.
+ *
+ * TIMER2 fires every 10ms. Each UART sends and receives one byte at a time
+ * at its baud rate, and UART1 drops CTS while it sends like the train
+ * controller. Bytes sent go to the channels output, and bytes received come
+ * from io_device_receive, or from the keyboard for COM2.
+ */
+
+/**
+ * Starts the simulated devices, called by io_init
+ */
+void io_devices_init();
+
+/**
+ * Runs the devices up to the current time, updating their registers
+ */
+void io_devices_poll();
+
+/**
+ * Sleeps until the next time a device could raise an interrupt, or jumps
+ * there in virtual time
+ */
+void io_devices_wait();
+
+/**
+ * Queues a byte to be received on a channel, it arrives after any bytes
+ * already queued at the channels baud rate
+ */
+void io_device_receive(int channel, char c);
+
+/**
+ * Used by io_can_get and io_getc, received bytes are read from the device
+ * queue rather than the data register
+ */
+int io_device_can_get(int channel);
+int io_device_getc(int channel);
+
+/**
+ * Sets where bytes sent on a channel go. COM1 defaults to stderr and COM2
+ * to stdout
+ */
+void io_device_set_output(int channel, void (*output)(char c));
+
+/**
+ * Time the devices run on, in microseconds, for anything simulated behind
+ * them such as the train controller. This is real, scaled, or virtual time
+ * depending on LOCAL_TIME, see lib/x86/devices.c
+ */
+long long io_device_time_us();
+#endif
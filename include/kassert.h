@@ -1,5 +1,56 @@
 #pragma once
 
+/*
+ * Assertion levels
+ *
+ * KASSERT is always checked, use it for cheap invariants which would
+ * otherwise corrupt memory. KASSERT_DEBUG and KASSERT_PARANOID only check at
+ * or above their level, so checks on hot paths can be compiled out of
+ * production builds (make KASSERT_LEVEL=0). PARANOID is for checks which are
+ * expensive themselves, such as walking a structure
+ *
+ * Both take the subsystem they belong to, e.g. KASSERT_DEBUG(IPC, ...), and
+ * each subsystem can be given its own level below, to debug one subsystem
+ * without slowing down the rest
+ */
+#define KASSERT_LEVEL_ALWAYS 0
+#define KASSERT_LEVEL_DEBUG 1
+#define KASSERT_LEVEL_PARANOID 2
+
+#ifndef KASSERT_LEVEL
+#if defined(DEBUG_MODE)
+#define KASSERT_LEVEL KASSERT_LEVEL_PARANOID
+#else
+#define KASSERT_LEVEL KASSERT_LEVEL_DEBUG
+#endif
+#endif
+
+// Per-subsystem levels, these default to KASSERT_LEVEL
+// Message passing in the user side of syscalls, e.g. Send and ReceiveStrict
+#ifndef KASSERT_IPC_LEVEL
+#define KASSERT_IPC_LEVEL KASSERT_LEVEL
+#endif
+// Library code such as jstring and cbuffer
+#ifndef KASSERT_LIB_LEVEL
+#define KASSERT_LIB_LEVEL KASSERT_LEVEL
+#endif
+// Track graph and train models, e.g. nextEdge and Velocity
+#ifndef KASSERT_TRACK_LEVEL
+#define KASSERT_TRACK_LEVEL KASSERT_LEVEL
+#endif
+// Segment reservations
+#ifndef KASSERT_RESERVOIR_LEVEL
+#define KASSERT_RESERVOIR_LEVEL KASSERT_LEVEL
+#endif
+
+// The level is a constant, so disabled checks are removed even without
+// optimizations, along with their arguments
+#define KASSERT_AT(subsystem, level, a, msg, ...) do { \
+  if (KASSERT_##subsystem##_LEVEL >= (level)) KASSERT(a, msg, ## __VA_ARGS__); \
+  } while(0)
+#define KASSERT_DEBUG(subsystem, a, msg, ...) KASSERT_AT(subsystem, KASSERT_LEVEL_DEBUG, a, msg, ## __VA_ARGS__)
+#define KASSERT_PARANOID(subsystem, a, msg, ...) KASSERT_AT(subsystem, KASSERT_LEVEL_PARANOID, a, msg, ## __VA_ARGS__)
+
 #ifndef NO_KASSERT
 
 #include <bwio.h>
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <io.h>
+#include <kern/task_descriptor.h>
+
+/*
+ * CPU budgets, for limiting how much time a group of low importance tasks
+ * (e.g. terminal rendering) can take away from the rest of the system.
+ *
+ * Each budget group may use `budget` worth of CPU time every `period_ticks`
+ * timer ticks. Once a group uses up its budget it is throttled: any of its
+ * tasks that become ready, or are still on a ready queue when they come up,
+ * are parked off the ready queues until the period ends and the budget is
+ * replenished.
+ */
+
+#define MAX_BUDGET_GROUPS 8
+
+// Length of a timer tick in ms, budget periods are counted in ticks
+#define BUDGET_TICK_MS 10
+
+#define NO_BUDGET_GROUP -1
+
+typedef struct {
+  bool in_use;
+  bool throttled;
+  // CPU time allowed, and used, in the current period
+  io_time_t budget;
+  io_time_t used;
+  int period_ticks;
+  int ticks_left;
+  // tasks that became ready while throttled, linked by next_ready_task
+  task_descriptor_t *parked;
+  task_descriptor_t *parked_end;
+
+  /* Diagnostics */
+  unsigned int throttle_events;
+} budget_group_t;
+
+extern budget_group_t budget_groups[MAX_BUDGET_GROUPS];
+
+void budget_init();
+
+/**
+ * Creates a budget group
+ * @return the group id, or -1 if all groups are in use
+ */
+int budget_create_group(unsigned int budget_ms, unsigned int period_ms);
+
+/**
+ * Moves a task into a budget group, or out of any with NO_BUDGET_GROUP. A
+ * parked task is requeued, and parked again if the new group is throttled
+ * @return 0 on success, -1 if the group is invalid
+ */
+int budget_join_group(task_descriptor_t *task, int group);
+
+/**
+ * Charges CPU time to the task's budget group, throttling it if it has
+ * used up its budget for the period
+ */
+void budget_charge(task_descriptor_t *task, io_time_t time);
+
+/**
+ * Advances budget periods by one timer tick, replenishing groups and
+ * releasing their parked tasks at the end of a period
+ */
+void budget_tick();
+
+/**
+ * Parks a task of a throttled group until its budget is replenished
+ */
+void budget_park_task(task_descriptor_t *task);
+
+/**
+ * Takes a parked task off its group's parked list, for when it's destroyed
+ * and its descriptor may be reused before the group is replenished
+ */
+void budget_unpark_task(task_descriptor_t *task);
+
+/**
+ * Checks if a task belongs to a throttled budget group, and so can't be
+ * put on the ready queues
+ */
+static inline bool budget_is_throttled(task_descriptor_t *task) {
+  return task->budget_group != NO_BUDGET_GROUP && budget_groups[task->budget_group].throttled;
+}
@@ -24,6 +24,14 @@ typedef int syscall_t;
 #define SYSCALL_MALLOC (syscall_t) 11
 #define SYSCALL_FREE (syscall_t) 12
 #define SYSCALL_DESTROY (syscall_t) 13
+#define SYSCALL_SET_QUANTUM (syscall_t) 14
+#define SYSCALL_BUDGET_CREATE (syscall_t) 15
+#define SYSCALL_BUDGET_JOIN (syscall_t) 16
+#define SYSCALL_REPLY_MANY (syscall_t) 17
+#define SYSCALL_SEND_V (syscall_t) 18
+#define SYSCALL_REPLY_V (syscall_t) 19
+#define SYSCALL_DUMP_TRACE (syscall_t) 20
+#define SYSCALL_GET_STATS (syscall_t) 21
 
 #define SYSCALL_HW_INT (syscall_t) 99
 
@@ -37,6 +45,10 @@ struct Context {
   int used_stacks;
   void *freed_stacks_buffer[MAX_TASK_STACKS];
   cbuffer_t freed_stacks;
+  // tid of the idle task, or -1 if it hasn't been created
+  int idle_task_tid;
+  // kernel wide counters for GetStats, ready queue lengths are filled on request
+  kernel_stats_t stats;
 };
 
 #ifndef __DEFINED_CONTEXT_T
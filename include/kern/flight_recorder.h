@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <io.h>
+
+/*
+ * Flight recorder
+ *
+ * A fixed size ring of binary records, written by tasks and the kernel
+ * through FlightRecord (see kernel.h). A record is a timestamp, tid, a
+ * printf format and up to 3 arguments, which are only formatted when the
+ * ring is printed. The format doubles as the event id, so records decode
+ * without a table of events. Writing a record is a handful of stores, and
+ * the ring never resets, so the last FLIGHT_RECORDER_SIZE records before a
+ * crash are printed by cleanup(), including from the abort handlers.
+ */
+
+// Must be a power of 2
+#define FLIGHT_RECORDER_SIZE 2048
+
+typedef struct {
+  io_time_t time;
+  int tid;
+  const char *fmt;
+  intptr_t args[3];
+} flight_record_t;
+
+extern flight_record_t flight_recorder[FLIGHT_RECORDER_SIZE];
+// total records written, the ring holds the last FLIGHT_RECORDER_SIZE
+extern volatile unsigned int flight_recorder_head;
+
+void flight_recorder_init();
+
+/**
+ * Prints the flight recorder, oldest record first, over COM2. Times are
+ * shown relative to when this is called
+ */
+void flight_recorder_dump();
+
+static inline void flight_record(int tid, const char *fmt, intptr_t a, intptr_t b, intptr_t c) {
+  // FIXME: a task preempted between reading and writing the head can share
+  // a slot with the task that preempted it. a lost record is preferable to
+  // a syscall per record
+  flight_record_t *record = &flight_recorder[flight_recorder_head++ & (FLIGHT_RECORDER_SIZE - 1)];
+  record->time = io_get_time();
+  record->tid = tid;
+  record->fmt = fmt;
+  record->args[0] = a;
+  record->args[1] = b;
+  record->args[2] = c;
+}
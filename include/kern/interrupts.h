@@ -18,3 +18,15 @@ void interrupts_disable_irq(await_event_t event_type);
 
 
 void interrupts_clear_all();
+
+#ifdef DEBUG_MODE
+/**
+ * Runs the simulated devices (x86), which can't interrupt a running task.
+ * Instead the kernel checks for interrupts before activating each task, and
+ * if there is one, handles it as if the task was interrupted right away
+ * @param  next_task about to be activated, if it's the idle task this
+ *                   sleeps until a device may interrupt
+ * @return           true if there is an interrupt for hwi
+ */
+bool interrupts_simulate(task_descriptor_t *next_task);
+#endif
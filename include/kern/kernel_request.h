@@ -28,6 +28,49 @@ typedef struct SyscallMessage {
 } syscall_message_t;
 
 
+/*
+ * Vectored message for SendV and ReplyV. The first fields line up with
+ * syscall_message_t, so it's handled as one everywhere but the copy
+ */
+typedef struct SyscallMessageV {
+  int tid;
+  volatile int status;
+  // total length of all fragments
+  volatile int msglen;
+  volatile char *msg;
+  const iovec_t *iov;
+  int iovcnt;
+} syscall_message_v_t;
+
+
+typedef struct SyscallReplyManyArg {
+  const int *tids;
+  int count;
+  // the reply copied to every task, status is set to the count replied to
+  syscall_message_t msg;
+} syscall_reply_many_arg_t;
+
+
+typedef struct SyscallQuantumArg {
+  int priority;
+  int ticks;
+} syscall_quantum_arg_t;
+
+
+typedef struct SyscallStatsArg {
+  kernel_stats_t *stats;
+  task_stats_t *tasks;
+  int max_tasks;
+} syscall_stats_arg_t;
+
+
+typedef struct SyscallBudgetArg {
+  // budget_ms and period_ms for BUDGET_CREATE, tid and group for BUDGET_JOIN
+  int arg1;
+  int arg2;
+} syscall_budget_arg_t;
+
+
 typedef struct SyscallAwaitEventArg {
   await_event_t event;
   char arg;
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <debug.h>
+
+/*
+ * Sampling profiler
+ *
+ * On every profiling tick the program counter of the interrupted task is
+ * recorded into a histogram keyed by task and function. On ARM the tick is
+ * the timer 2 interrupt, and functions are found through the names poked
+ * in by -mpoke-function-name. On x86 the tick is SIGPROF from setitimer,
+ * and samples are keyed by program counter and named through dladdr.
+ *
+ * The histogram is printed by cleanup() on ARM, and when the kernel exits
+ * on x86, as the top functions of each task.
+ *
+ * Only built with KERNEL_PROFILE, see debug.h
+ */
+
+// Must be a power of 2
+#define PROFILE_BUCKETS 1024
+
+// tid of an unused bucket, and of a bucket merged into another when printing
+#define PROFILE_EMPTY -1
+#define PROFILE_MERGED -2
+
+// Functions printed per task
+#define PROFILE_TOP_FUNCTIONS 5
+
+typedef struct {
+  int tid;
+  // start of the sampled function, or the sampled pc if it can't be found
+  uintptr_t func;
+  unsigned int samples;
+} profile_bucket_t;
+
+void profile_init();
+
+/**
+ * Prints the top functions of each task over COM2
+ */
+void profile_dump();
+
+/**
+ * Records a sample into the histogram. Safe to call from a signal handler
+ * @param tid of the interrupted task
+ * @param pc  the task was interrupted at
+ */
+void profile_sample(int tid, uintptr_t pc);
+
+/*
+ * Architecture specific
+ */
+
+/**
+ * Starts the profiling tick, if the architecture has one separate from the
+ * timer interrupt
+ */
+void profile_arch_init();
+
+/**
+ * Finds the start of the function containing pc. This is called for every
+ * sample, so it must be cheap and safe to call from a signal handler
+ * @param  pc
+ * @return    the function start, or pc if it can't be found
+ */
+uintptr_t profile_func_start(uintptr_t pc);
+
+/**
+ * Finds the start of the function containing a value returned by
+ * profile_func_start. Only called when printing, so it may be slow
+ * @param  func
+ * @return      the function start, or func if it can't be found
+ */
+uintptr_t profile_func_resolve(uintptr_t func);
+
+/**
+ * Gets the name of a function found by profile_func_resolve
+ * @param  func
+ * @return      a name, or NULL if there is none
+ */
+const char *profile_func_name(uintptr_t func);
@@ -1,17 +1,38 @@
 #pragma once
 
 #include <basic.h>
+#include <util.h>
 #include <kern/task_descriptor.h>
 #include <kern/kernel_request.h>
+#include <kern/budget.h>
 
 #define MIN_PRIORITY 0
 #define MAX_PRIORITY 31
 
+// Default time slice, in timer ticks (10ms), for every priority
+#define DEFAULT_QUANTUM_TICKS 1
+
 extern unsigned long int priotities_ready;
 
 extern task_descriptor_t *ready_queues[MAX_PRIORITY + 1];
 extern task_descriptor_t *ready_queues_end[MAX_PRIORITY + 1];
 
+/*
+ * handoff_task is a task that should run next, bypassing the ready queues.
+ * It is set when a syscall unblocks a partner task that is at least as
+ * important as the caller (e.g. Send to a RECEIVE_BLOCKED server), so the
+ * kernel switches directly to it. NULL if there is no handoff pending
+ */
+extern task_descriptor_t *handoff_task;
+
+/*
+ * Time slice of each priority, in timer ticks. A task that is still running
+ * after this many ticks is moved to the back of its ready queue, so
+ * same-priority peers get to run. A quantum of 0 disables time slicing for
+ * the priority, so tasks run until they block or a more important task is ready
+ */
+extern int scheduler_quanta[MAX_PRIORITY + 1];
+
 /*
  * functionality for scheduling and swapping the active task as
  * part of scheduling
@@ -61,11 +82,56 @@ kernel_request_t *scheduler_activate_task(task_descriptor_t *task);
  */
 void scheduler_requeue_task(task_descriptor_t *task);
 
+/**
+ * Puts a task onto the front of the ready queue, used when a task was
+ * interrupted but still has time left in its quantum
+ */
+void scheduler_requeue_task_front(task_descriptor_t *task);
+
+/**
+ * Takes a task off its ready queue, or cancels its handoff, for when it's
+ * destroyed and its descriptor may be reused before it would be skipped
+ */
+void scheduler_remove_task(task_descriptor_t *task);
+
+/**
+ * Accounts a timer tick against the interrupted task, requeueing it at the
+ * back of the ready queue if its quantum ran out, otherwise at the front
+ */
+void scheduler_tick(task_descriptor_t *task);
+
+/**
+ * Sets the time slice for a priority
+ * @param priority to change
+ * @param ticks    quantum in timer ticks, or 0 to disable time slicing
+ */
+void scheduler_set_quantum(int priority, int ticks);
+
 /**
  * Checks if there are any other tasks to schedule
  */
 static inline bool scheduler_any_task() {
-  return !!priotities_ready;
+  return handoff_task != NULL || !!priotities_ready;
+}
+
+/**
+ * Checks if the kernel can switch directly from the current task to target,
+ * without going through the ready queues. This is only allowed if the target
+ * is at least as important as the current task, and no task as important as
+ * the target is waiting on the ready queues, so it doesn't jump ahead of its
+ * peers
+ */
+static inline bool scheduler_can_handoff(task_descriptor_t *current, task_descriptor_t *target) {
+  return handoff_task == NULL && target->priority <= current->priority && !budget_is_throttled(target) &&
+    (priotities_ready == 0 || ctz(priotities_ready) > target->priority);
+}
+
+/**
+ * Makes task the next task to run, skipping the ready queues. Only valid
+ * if scheduler_can_handoff was true for the task
+ */
+static inline void scheduler_handoff_task(task_descriptor_t *task) {
+  handoff_task = task;
 }
 
 /**
@@ -74,7 +140,7 @@ static inline bool scheduler_any_task() {
 task_descriptor_t *scheduler_next_task();
 
 /**
- * Gets the count of tasks currently on the ready queue
+ * Gets the count of tasks currently on the ready queue, and a pending handoff
  * NOTE: should only be used for debugging
  */
 int scheduler_ready_queue_size();
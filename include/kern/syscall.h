@@ -13,11 +13,16 @@ void syscall_exit(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_send(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_receive(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_reply(task_descriptor_t *task, kernel_request_t *arg);
+void syscall_reply_many(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_await(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_exit_kernel(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_malloc(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_free(task_descriptor_t *task, kernel_request_t *arg);
 void syscall_destroy(task_descriptor_t *task, kernel_request_t *arg);
+void syscall_set_quantum(task_descriptor_t *task, kernel_request_t *arg);
+void syscall_budget_create(task_descriptor_t *task, kernel_request_t *arg);
+void syscall_budget_join(task_descriptor_t *task, kernel_request_t *arg);
+void syscall_get_stats(task_descriptor_t *task, kernel_request_t *arg);
 
 void hwi(task_descriptor_t *task, kernel_request_t *arg);
 void hwi_uart1_rx(task_descriptor_t *task, kernel_request_t *arg);
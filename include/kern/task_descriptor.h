@@ -20,25 +20,20 @@ typedef struct Context context_t;
  * - all state needed to begin or resume (stack pointer, entry point)
  */
 
-// FIXME: make this an enum
-typedef int task_state_t;
-#define STATE_ACTIVE (task_state_t) 1
-#define STATE_READY (task_state_t) 2
-#define STATE_ZOMBIE (task_state_t) 3
-#define STATE_SEND_BLOCKED (task_state_t) 4
-#define STATE_RECEIVE_BLOCKED (task_state_t) 5
-#define STATE_REPLY_BLOCKED (task_state_t) 6
-#define STATE_EVENT_BLOCKED (task_state_t) 7
-
 #define KERNEL_TID -1
 
-// NOTE: priorities can be found in kernel.h
+// NOTE: task states and priorities can be found in kernel.h
 
 struct TaskDescriptor {
   int tid;
   // For re-allocatable stacks
   int stack_id;
   int parent_tid;
+  // Children, including exited or destroyed ones until their tid is reused,
+  // linked by sibling tids. -1 for none
+  int first_child;
+  int next_sibling;
+  int prev_sibling;
   bool has_started;
   bool was_interrupted;
   int priority;
@@ -55,11 +50,40 @@ struct TaskDescriptor {
 
   bool is_recyclable;
 
+  // timer ticks this task has run for since its quantum last ran out, or it
+  // last blocked
+  int quantum_used;
+
+  // CPU budget group, inherited by created tasks. NO_BUDGET_GROUP if none
+  int budget_group;
+  // on its budget group's parked list instead of a ready queue
+  bool is_parked;
+
   /* Diagnostics */
   io_time_t execution_time;
   io_time_t send_execution_time;
   io_time_t recv_execution_time;
   io_time_t repl_execution_time;
+  // times this task was moved to the back of its ready queue by time slicing
+  unsigned int preemptions;
+  // times this task used up the rest of its budget group's CPU budget
+  unsigned int throttles;
+  // times this task was switched to
+  unsigned int activations;
+  // messages this task has received from Send or SendV
+  unsigned int messages_received;
+  // time the last message received waited in the send queue, 0 if this task
+  // was already waiting in Receive
+  io_time_t last_queue_wait;
+  // largest number of tasks that were waiting in the send queue at once
+  int max_send_queue_length;
+  // total time spent in each blocked state, see td_set_state
+  io_time_t send_blocked_time;
+  io_time_t receive_blocked_time;
+  io_time_t reply_blocked_time;
+  io_time_t event_blocked_time;
+  // when the task entered its current state, only kept for blocked states
+  io_time_t state_since;
   char name[128];
 };
 
@@ -69,5 +93,41 @@ task_descriptor_t *td_create(context_t *ctx, int parent_tid, int priority, void
 
 void td_free_stack(int tid);
 
+/**
+ * Moves a task into a new state, adding the time spent in the state it is
+ * leaving to its blocked time counters. This should be used for every
+ * transition into or out of a blocked state
+ * @param task  to change
+ * @param state to move to
+ */
+static inline void td_set_state(task_descriptor_t *task, task_state_t state) {
+  io_time_t now = io_get_time();
+  switch (task->state) {
+  case STATE_SEND_BLOCKED:
+    task->send_blocked_time += now - task->state_since;
+    break;
+  case STATE_RECEIVE_BLOCKED:
+    task->receive_blocked_time += now - task->state_since;
+    break;
+  case STATE_REPLY_BLOCKED:
+    task->reply_blocked_time += now - task->state_since;
+    break;
+  case STATE_EVENT_BLOCKED:
+    task->event_blocked_time += now - task->state_since;
+    break;
+  }
+  switch (state) {
+  case STATE_SEND_BLOCKED:
+  case STATE_RECEIVE_BLOCKED:
+  case STATE_REPLY_BLOCKED:
+  case STATE_EVENT_BLOCKED:
+    // blocking gives up the rest of the time slice
+    task->quantum_used = 0;
+    break;
+  }
+  task->state = state;
+  task->state_since = now;
+}
+
 #define _TaskStackSize 0x10000
-extern char *TaskStack;
+extern char TaskStack[];
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <io.h>
+#include <debug.h>
+
+/*
+ * Kernel event trace
+ *
+ * A fixed size ring of binary events recorded by the kernel: task switches,
+ * syscalls, interrupts and AwaitEvent wakeups, each stamped with io_get_time.
+ * Recording an event is a handful of stores, but the dump prints the whole
+ * ring, so this is only built in with KERNEL_TRACE (see debug.h).
+ * The ring is dumped as text by cleanup() or the DumpTrace syscall, and
+ * tools/trace_decode turns a dump into Chrome trace-event JSON and latency
+ * statistics.
+ */
+
+// Must be a power of 2
+#define TRACE_SIZE 4096
+
+// Event types
+#define TRACE_SWITCH 1    // code: 0, tid: task being activated, arg: priority
+#define TRACE_SYSCALL 2   // code: syscall_t, tid: caller, arg: target tid or -1
+#define TRACE_INTERRUPT 3 // code: trace_interrupt_t, tid: interrupted task
+#define TRACE_AWAKE 4     // code: await_event_t, tid: woken task
+
+// Interrupt sources for TRACE_INTERRUPT
+#define TRACE_INTERRUPT_UNKNOWN 0
+#define TRACE_INTERRUPT_TIMER2 1
+#define TRACE_INTERRUPT_UART1 2
+#define TRACE_INTERRUPT_UART2 3
+
+typedef struct {
+  io_time_t time;
+  unsigned char type;
+  unsigned char code;
+  short tid;
+  int arg;
+} trace_event_t;
+
+extern trace_event_t trace_ring[TRACE_SIZE];
+// total events recorded, the ring holds the last TRACE_SIZE of them
+extern unsigned int trace_head;
+
+void trace_init();
+
+/**
+ * Prints the trace ring, oldest event first, over COM2
+ */
+void trace_dump();
+
+#if KERNEL_TRACE
+static inline void trace_record(int type, int code, int tid, int arg) {
+  trace_event_t *event = &trace_ring[trace_head++ & (TRACE_SIZE - 1)];
+  event->time = io_get_time();
+  event->type = type;
+  event->code = code;
+  event->tid = tid;
+  event->arg = arg;
+}
+#else
+#define trace_record(type, code, tid, arg) NOP
+#endif
@@ -2,6 +2,7 @@
 
 #include <kassert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <io.h>
 
 // Hardcoded maximum used in a number of places
@@ -12,7 +13,17 @@
 #else
 #define MAX_TASKS 256
 #endif
+
+// Task stacks are preallocated, so this bounds the number of live tasks.
+// Local builds have one for each tid, but MAX_TASKS stacks don't fit in the
+// ARM's 32MB. Overridable from the Makefile, e.g. MAX_TASK_STACKS=200
+#ifndef MAX_TASK_STACKS
+#if !defined(DEBUG_MODE)
 #define MAX_TASK_STACKS 100
+#else
+#define MAX_TASK_STACKS MAX_TASKS
+#endif
+#endif
 
 /*
  * Kernel system calls
@@ -96,6 +107,13 @@ int Send( int tid, void *msg, int msglen, volatile void *reply, int replylen);
  */
 int Receive( int *tid, volatile void *msg, int msglen );
 
+/**
+ * Gets how long the message from the last Receive waited in the send queue,
+ * before this task received it
+ * @return the wait, or 0 if this task was already waiting in Receive
+ */
+io_time_t LastReceiveQueueWait();
+
 /**
  * For asserting that the data size you receive is strictly smaller than
  * a buffer provided. Helps ensures no buffers are unexpectedly overflowed.
@@ -106,7 +124,7 @@ int Receive( int *tid, volatile void *msg, int msglen );
  */
 static inline int ReceiveStrict(int * tid, void * ret, int ret_len) {
   int result = Receive(tid, ret, ret_len);
-  KASSERT(result < ret_len, "Receive got result >= buffer_len. result=%d buffer_len=%d", result, ret_len);
+  KASSERT_DEBUG(IPC, result < ret_len, "Receive got result >= buffer_len. result=%d buffer_len=%d", result, ret_len);
   return result;
 }
 
@@ -119,6 +137,47 @@ static inline int ReceiveStrict(int * tid, void * ret, int ret_len) {
  */
 int Reply( int tid, void *reply, int replylen );
 
+/**
+ * A fragment of a message, for SendV and ReplyV
+ */
+typedef struct {
+  const void *base;
+  int len;
+} iovec_t;
+
+/**
+ * Send a message made of several fragments. The kernel gathers the fragments
+ * directly into the receivers buffer, so there is no need to assemble them
+ * into one buffer first. Otherwise the same as Send
+ * @param  tid      to send to
+ * @param  iov      fragments of the message, in order
+ * @param  iovcnt   number of fragments
+ * @param  reply    to copy a reply to
+ * @param  replylen size of reply buffer
+ * @return          bytes read into reply buffer, or error if < 0
+ */
+int SendV( int tid, const iovec_t *iov, int iovcnt, volatile void *reply, int replylen );
+
+/**
+ * Reply with a message made of several fragments, see SendV
+ * @param  tid    to reply to
+ * @param  iov    fragments of the reply, in order
+ * @param  iovcnt number of fragments
+ * @return        same as Reply
+ */
+int ReplyV( int tid, const iovec_t *iov, int iovcnt );
+
+/**
+ * Reply with the same data to many tasks, unblocking all of them in a single
+ * kernel entry. Tasks which aren't reply blocked on this task are skipped
+ * @param  tids     to reply to
+ * @param  count    of tids
+ * @param  reply    data to reply with
+ * @param  replylen of data
+ * @return          the number of tasks replied to
+ */
+int ReplyMany( const int *tids, int count, void *reply, int replylen );
+
 /**
  * These are several macros for more cleanly using null amounts, or sizeof
  */
@@ -150,11 +209,123 @@ enum await_event_t {
   EVENT_NUM_TYPES,
 }; typedef int await_event_t;
 
+/**
+ * Blocks until the event happens
+ * @return the byte received for EVENT_UART*_RX, otherwise 0
+ */
 int AwaitEvent( await_event_t event_type );
 int AwaitEventPut( await_event_t event_type, char ch );
 
 io_time_t GetIdleTaskExecutionTime();
 
+// Size of kernel_stats_t.syscall_counts, must be larger than every syscall number
+#define STATS_MAX_SYSCALLS 32
+
+/**
+ * Kernel wide counters, as returned by GetStats
+ */
+typedef struct {
+  // time the idle task has run for
+  io_time_t idle_time;
+  // time every task has run for, so the rest of the time was in the kernel
+  io_time_t task_time;
+  // kernel entries by syscall number, see kern/context.h
+  unsigned int syscall_counts[STATS_MAX_SYSCALLS];
+  // kernel entries from hardware interrupts
+  unsigned int interrupt_count;
+  // tasks waiting in each ready queue, when the snapshot was taken
+  int ready_queue_length[32];
+} kernel_stats_t;
+
+// FIXME: make this an enum
+typedef int task_state_t;
+#define STATE_ACTIVE (task_state_t) 1
+#define STATE_READY (task_state_t) 2
+#define STATE_ZOMBIE (task_state_t) 3
+#define STATE_SEND_BLOCKED (task_state_t) 4
+#define STATE_RECEIVE_BLOCKED (task_state_t) 5
+#define STATE_REPLY_BLOCKED (task_state_t) 6
+#define STATE_EVENT_BLOCKED (task_state_t) 7
+
+/**
+ * A snapshot of a single task, as returned by GetStats. Blocked times are
+ * named after the task states, so a task waiting in Receive is send blocked
+ * and a task waiting for a receiver to pick up its Send is receive blocked
+ */
+typedef struct {
+  int tid;
+  int priority;
+  task_state_t state;
+  // points into the kernels task descriptor, only valid while the task lives
+  const char *name;
+  io_time_t execution_time;
+  // times the task was switched to
+  unsigned int activations;
+  // messages received from Send or SendV
+  unsigned int messages_received;
+  int send_queue_length;
+  int max_send_queue_length;
+  io_time_t send_blocked_time;
+  io_time_t receive_blocked_time;
+  io_time_t reply_blocked_time;
+  io_time_t event_blocked_time;
+} task_stats_t;
+
+/**
+ * Takes a snapshot of kernel and per-task counters in a single kernel entry.
+ * Tasks are copied in tid order, skipping destroyed ones
+ * @param  stats     to copy kernel counters to (OUTPUT), may be NULL
+ * @param  tasks     to copy task snapshots to (OUTPUT), may be NULL
+ * @param  max_tasks size of tasks
+ * @return           the number of tasks copied
+ */
+int GetStats(kernel_stats_t *stats, task_stats_t *tasks, int max_tasks);
+
+/**
+ * Prints the kernel event trace over COM2, for decoding with
+ * tools/trace_decode. This busy-waits on the UART, so timing after the
+ * dump won't be representative
+ */
+void DumpTrace();
+
+/**
+ * Sets the time slice for all tasks at a priority. When a task has run for
+ * this many timer ticks (10ms) without blocking, it is moved behind other
+ * ready tasks of the same priority
+ * @param priority to change
+ * @param ticks    quantum in timer ticks, or 0 to never time slice
+ */
+void SetQuantum(int priority, int ticks);
+
+/**
+ * Creates a CPU budget group. Tasks in the group may together use at most
+ * budget_ms of CPU time every period_ms, after which they are not scheduled
+ * until the next period begins
+ * @param  budget_ms CPU time allowed per period
+ * @param  period_ms length of a period, rounded down to timer ticks (10ms)
+ * @return           the group id, or -1 if no more groups can be created
+ */
+int CreateBudgetGroup(unsigned int budget_ms, unsigned int period_ms);
+
+/**
+ * Moves a task into a CPU budget group. Tasks it creates afterwards are also
+ * put into the group
+ * @param  tid   of the task to move
+ * @param  group to move into, or -1 to remove the task from its group
+ * @return       0 on success, -1 if the task or group is invalid
+ */
+int JoinBudgetGroup(int tid, int group);
+
+/**
+ * Records an event into the flight recorder (see kern/flight_recorder.h).
+ * Nothing is formatted until the recorder is printed on exit, so this is
+ * cheap enough for hot paths. Arguments are integers, or pointers to strings
+ * which live for the whole program such as literals and track node names
+ * @param fmt     printf format of the event, must be a string literal
+ * @param a, b, c arguments for the format, unused ones are ignored
+ */
+void FlightRecord(const char *fmt, intptr_t a, intptr_t b, intptr_t c);
+
 void RecordLog(const char *msg);
 void RecordLogi(int i);
 
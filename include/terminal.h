@@ -4,6 +4,7 @@
 #define SWITCH_LOCATION 3
 #define SENSOR_HISTORY_LOCATION 10
 #define COMMAND_LOCATION 23
+#define TOP_LOCATION 40
 
 // Terminal codes
 #define CLEAR_TERMINAL "\e\x5b" "\x32" "\x4a"
@@ -88,7 +88,13 @@
 
 // Memory access. This is here to make it easy to find code that is
 // TS7200 specific, when it hits memory
+#if defined(DEBUG_MODE)
+// x86 has none of these devices, so registers are simulated (lib/x86/devices.c)
+volatile unsigned int *io_device_register(unsigned int address);
+#define VMEM(x) (*io_device_register((unsigned int) (x)))
+#else
 #define VMEM(x) *((volatile unsigned int *)(x))
+#endif
 
 // Interrupt stuff
 #define VIC1_BASE 0x800B0000
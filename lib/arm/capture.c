@@ -0,0 +1,20 @@
+#include <basic.h>
+#include <bwio.h>
+#include <capture.h>
+#include <debug.h>
+#include <terminal.h>
+
+void capture_init() {
+  capture_start(INPUT_CAPTURE);
+}
+
+void capture_dump() {
+  if (!capture_enabled) return;
+  bwputstr(COM2, "\n\r" WHITE_BG BLACK_FG "===== CAPTURE" RESET_ATTRIBUTES "\n\r");
+  bwprintf(COM2, "CAPTURE_BEGIN %u %u\n\r", capture_length, capture_dropped);
+  for (unsigned int i = 0; i < capture_length; i++) {
+    bwputx(COM2, capture_buffer[i]);
+    if (i % 32 == 31) bwputstr(COM2, "\n\r");
+  }
+  bwputstr(COM2, "\n\rCAPTURE_END\n\r");
+}
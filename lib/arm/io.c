@@ -104,6 +104,15 @@ unsigned int io_time_difference_ms(io_time_t current, io_time_t prev) {
   return (current - prev) / CLOCKS_PER_MILLISECOND;
 }
 
+io_time_t io_time_from_ms(unsigned int ms) {
+  return ms * CLOCKS_PER_MILLISECOND;
+}
+
+io_time_t io_time_since_tick() {
+  // TIMER2 counts down from its load value at the same 508khz as TIMER3
+  return VMEM(TIMER2_BASE + LDR_OFFSET) - VMEM(TIMER2_BASE + VAL_OFFSET);
+}
+
 unsigned int io_time_difference_us(io_time_t current, io_time_t prev) {
   // FIXME: This overflow check may not be correct
   if (prev > current) prev = MAX_TIME - prev + current;
@@ -123,7 +132,7 @@ bool ts7200_uart1_get_cts() {
 // 0 => OK
 // -1 => ERROR: UART buffer is full
 // -2 => ERROR: bad channel
-int can_put(int channel) {
+int io_can_put(int channel) {
   int *flags;
   switch( channel ) {
   case COM1:
@@ -146,7 +155,7 @@ int can_put(int channel) {
 // 0 => OK
 // -1 => ERROR: UART buffer is full
 // -2 => ERROR: bad channel
-int ts_putc(int channel, char c) {
+int io_putc(int channel, char c) {
   int *data;
   switch( channel ) {
   case COM1:
@@ -159,7 +168,7 @@ int ts_putc(int channel, char c) {
     return -2;
     break;
   }
-  int status = can_put(channel);
+  int status = io_can_put(channel);
   if (status != 0) return status;
   *data = c;
   return 0;
@@ -169,7 +178,7 @@ int ts_putc(int channel, char c) {
 // 0 => OK
 // -1 => ERROR: UART buffer is empty
 // -2 => ERROR: bad channel
-int can_get(int channel) {
+int io_can_get(int channel) {
   int *flags;
   switch( channel ) {
   case COM1:
@@ -194,7 +203,7 @@ int can_get(int channel) {
 // 0 => OK
 // -1 => ERROR: UART buffer is empty
 // -2 => ERROR: bad channel
-int get(int channel) {
+int io_getc(int channel) {
   int *data;
   unsigned char c;
   switch( channel ) {
@@ -208,7 +217,7 @@ int get(int channel) {
     return -2;
     break;
   }
-  int status = can_get(channel);
+  int status = io_can_get(channel);
   if (status != 0) return status;
   c = *data;
   return c;
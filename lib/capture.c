@@ -0,0 +1,69 @@
+#include <basic.h>
+#include <capture.h>
+#include <io.h>
+
+char capture_buffer[CAPTURE_SIZE];
+unsigned int capture_length;
+unsigned int capture_dropped;
+bool capture_enabled = false;
+
+static io_time_t capture_last_time;
+
+void capture_start(bool enabled) {
+  capture_length = 0;
+  capture_dropped = 0;
+  capture_last_time = io_get_time();
+  capture_enabled = enabled;
+}
+
+static int varint_encode(unsigned int value, char *out) {
+  int n = 0;
+  do {
+    out[n] = value & 0x7F;
+    value >>= 7;
+    if (value) out[n] |= 0x80;
+    n++;
+  } while (value);
+  return n;
+}
+
+void capture_record(int type, char c) {
+  if (!capture_enabled) return;
+  io_time_t now = io_get_time();
+  unsigned int delta_us = io_time_difference_us(now, capture_last_time);
+
+  char event[6];
+  int n = varint_encode((delta_us << 2) | type, event);
+  if (type != CAPTURE_TICK) event[n++] = c;
+
+  // a replay needs every event up to its end, so stop rather than wrap
+  if (capture_length + n > CAPTURE_SIZE) {
+    capture_dropped++;
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    capture_buffer[capture_length++] = event[i];
+  }
+  capture_last_time = now;
+}
+
+int capture_decode(const char *data, unsigned int len, unsigned int *pos, capture_event_t *event) {
+  unsigned int i = *pos;
+  unsigned int value = 0;
+  int shift = 0;
+  while (true) {
+    if (i >= len) return -1;
+    unsigned char byte = data[i++];
+    value |= (byte & 0x7F) << shift;
+    shift += 7;
+    if (!(byte & 0x80)) break;
+  }
+  event->type = value & 0x3;
+  event->delta_us = value >> 2;
+  if (event->type != CAPTURE_TICK) {
+    if (i >= len) return -1;
+    event->c = data[i++];
+  }
+  *pos = i;
+  return 0;
+}
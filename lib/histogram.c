@@ -0,0 +1,60 @@
+#include <basic.h>
+#include <histogram.h>
+
+void histogram_init(histogram_t *histogram) {
+  histogram->count = 0;
+  histogram->min = 0;
+  histogram->max = 0;
+  histogram->total = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    histogram->buckets[i] = 0;
+  }
+}
+
+static int bucket_of(unsigned int value) {
+  int bucket = 0;
+  while (value != 0) {
+    value >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void histogram_add(histogram_t *histogram, unsigned int value) {
+  if (histogram->count == 0 || value < histogram->min) histogram->min = value;
+  if (histogram->count == 0 || value > histogram->max) histogram->max = value;
+  histogram->count++;
+  histogram->total += value;
+  histogram->buckets[bucket_of(value)]++;
+}
+
+void histogram_merge(histogram_t *histogram, const histogram_t *other) {
+  if (other->count == 0) return;
+  if (histogram->count == 0 || other->min < histogram->min) histogram->min = other->min;
+  if (histogram->count == 0 || other->max > histogram->max) histogram->max = other->max;
+  histogram->count += other->count;
+  histogram->total += other->total;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    histogram->buckets[i] += other->buckets[i];
+  }
+}
+
+unsigned int histogram_percentile(const histogram_t *histogram, int permille) {
+  if (histogram->count == 0) return 0;
+  // the rank of the value, from 1, rounded up. Split so it can't overflow
+  unsigned int rank = histogram->count / 1000 * permille + ((histogram->count % 1000) * permille + 999) / 1000;
+  if (rank == 0) return histogram->min;
+
+  unsigned int seen = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      // bucket i tops out at 2^i - 1
+      unsigned int top = i == 0 ? 0 : i == 32 ? 0xFFFFFFFF : (1u << i) - 1;
+      if (top < histogram->min) return histogram->min;
+      if (top > histogram->max) return histogram->max;
+      return top;
+    }
+  }
+  return histogram->max;
+}
@@ -7,6 +7,7 @@ void map_init(map_t *map, map_val_t *buf, int buf_size) {
 
   map->size = 0;
   map->max_size = buf_size;
+  map->values = buf;
   for (i = 0; i < buf_size; i++) {
     map->values[i].key = NULL;
     map->values[i].val = NULL;
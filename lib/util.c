@@ -218,7 +218,7 @@ void l2a( long int num, char *bf ) {
 
 
 char c2x( char ch ) {
-  KASSERT(ch < 16, "Bad character given. Got ch=%c", ch);
+  KASSERT_DEBUG(LIB, ch < 16, "Bad character given. Got ch=%c", ch);
   if ( (ch <= 9) ) return '0' + ch;
   return 'a' + ch - 10;
 }
@@ -0,0 +1,21 @@
+#include <basic.h>
+#include <capture.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+void capture_init() {
+  capture_start(getenv("LOCAL_CAPTURE") != NULL);
+}
+
+void capture_dump() {
+  if (!capture_enabled) return;
+  const char *path = getenv("LOCAL_CAPTURE");
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not write capture to %s\n", path);
+    return;
+  }
+  fwrite(capture_buffer, 1, capture_length, file);
+  fclose(file);
+  fprintf(stderr, "Wrote capture of %u bytes to %s, %u events dropped\n", capture_length, path, capture_dropped);
+}
@@ -1,16 +1,16 @@
 #include <clock.h>
+#include <io.h>
 #include <ts7200.h>
 
-#define CLOCKS_PER_MILLISECOND (CLOCKS_PER_SEC / 1000)
-
 void clock_init() {
 
 }
 
 ktime_t clock_get_ticks() {
-  return clock();
+  // microseconds, on the same clock as the simulated devices
+  return io_device_time_us();
 }
 
 unsigned int clock_ms_difference(ktime_t current, ktime_t prev) {
-  return (current - prev) / CLOCKS_PER_MILLISECOND;
+  return (current - prev) / 1000;
 }
@@ -0,0 +1,383 @@
+/*
+ * devices.c - simulated TS-7200 timer and UARTs for x86
+ *
+ * VMEM goes through io_device_register, which gives every register address
+ * a slot in a small register file. The kernel reads and writes registers
+ * like on the board, and io_devices_poll moves the devices along: it notices
+ * writes to the data and timer clear registers, updates the flag and
+ * interrupt registers, and sets the VIC status the kernel checks in hwi. The
+ * VIC enable registers are plain registers, see src/x86/interrupts.c
+ *
+ * Every device runs on io_device_time_us, which is real time by default.
+ * LOCAL_TIME=virtual in the environment makes it a virtual clock which only
+ * moves a small step per kernel pass, and jumps to the next device event
+ * when only the idle task can run. Runs are then reproducible, and as fast
+ * as the host allows. The keyboard isn't read in virtual time, as key
+ * presses would make runs differ. LOCAL_TIME=<ratio> instead runs real time
+ * scaled by ratio, e.g. 10 to run ten times faster than the track.
+ *
+ * LOCAL_REPLAY=<file> replays a capture (see capture.h): timer ticks and
+ * received bytes happen when they did in the capture, and nothing else is
+ * received. Once the capture ends the timer ticks on its own again.
+ */
+
+#include <basic.h>
+#include <assert.h>
+#include <capture.h>
+#include <io.h>
+#include <ncurses.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ts7200.h>
+
+#define DEVICE_REGISTERS 64
+
+// A register that is only written by the kernel holds this until written,
+// it can't be a byte sent (even sign extended) or the 0 that clears timer2
+#define REGISTER_UNWRITTEN 0x80000000
+
+#define TIMER2_TICK_US 10000
+#define KEYBOARD_POLL_US 1000
+#define DEVICE_WAIT_MAX_US 1000
+
+// Virtual time for each io_devices_poll, roughly a syscall and context
+// switch on the board. It also keeps time moving for tasks that never block
+#define VIRTUAL_POLL_US 10
+
+// 2400 baud with 8 data and 2 stop bits, and 115200 baud with 8N1
+#define UART1_BYTE_US 4583
+#define UART2_BYTE_US 87
+
+#define UART_QUEUE_SIZE 1024
+
+static unsigned int register_addresses[DEVICE_REGISTERS];
+static volatile unsigned int registers[DEVICE_REGISTERS];
+static int used_registers = 0;
+
+volatile unsigned int *io_device_register(unsigned int address) {
+  for (int i = 0; i < used_registers; i++) {
+    if (register_addresses[i] == address) return &registers[i];
+  }
+  assert(used_registers < DEVICE_REGISTERS);
+  register_addresses[used_registers] = address;
+  registers[used_registers] = 0;
+  return &registers[used_registers++];
+}
+
+#define REGISTER(address) (*io_device_register(address))
+
+typedef struct {
+  unsigned int base;
+  long long byte_us;
+  // UART1 holds CTS low while the train controller takes a byte
+  bool has_cts;
+
+  // bytes still on the line, and bytes received but not read yet
+  char line[UART_QUEUE_SIZE];
+  int line_start;
+  int line_len;
+  long long line_next;
+  char rx[UART_QUEUE_SIZE];
+  int rx_start;
+  int rx_len;
+
+  long long tx_done;
+  bool cts;
+  bool modem_pending;
+  bool modem_raised;
+
+  void (*output)(char c);
+} device_uart_t;
+
+static device_uart_t uarts[2];
+
+static bool replaying = false;
+static char *replay_data = NULL;
+static unsigned int replay_len;
+static unsigned int replay_pos;
+static capture_event_t replay_next;
+static long long replay_next_time;
+
+static long long timer2_next_tick;
+static unsigned int timer2_ticks_owed;
+static long long keyboard_next_poll;
+
+static long long earliest(long long a, long long b) {
+  return a < b ? a : b;
+}
+
+static bool virtual_time = false;
+static long long virtual_time_us = 0;
+// real time is scaled by the ratio since the devices started
+static double time_ratio = 1.0;
+static long long real_start_us = 0;
+
+static long long real_time_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+long long io_device_time_us() {
+  if (virtual_time) return virtual_time_us;
+  return (long long) ((real_time_us() - real_start_us) * time_ratio);
+}
+
+static void time_init() {
+  const char *mode = getenv("LOCAL_TIME");
+  virtual_time = false;
+  virtual_time_us = 0;
+  time_ratio = 1.0;
+  if (mode != NULL && strcmp(mode, "virtual") == 0) {
+    virtual_time = true;
+  } else if (mode != NULL && strcmp(mode, "real") != 0) {
+    time_ratio = atof(mode);
+    assert(time_ratio > 0);
+  }
+  real_start_us = real_time_us();
+}
+
+static void output_stderr(char c) {
+  putc(c, stderr);
+}
+
+static void output_stdout(char c) {
+  putchar(c);
+}
+
+static void queue_push(char *queue, int *start, int *len, char c) {
+  // like the board, bytes nobody reads in time are lost
+  if (*len == UART_QUEUE_SIZE) return;
+  queue[(*start + *len) % UART_QUEUE_SIZE] = c;
+  (*len)++;
+}
+
+static char queue_pop(char *queue, int *start, int *len) {
+  char c = queue[*start];
+  *start = (*start + 1) % UART_QUEUE_SIZE;
+  (*len)--;
+  return c;
+}
+
+static void uart_init(device_uart_t *uart, unsigned int base, long long byte_us, bool has_cts, void (*output)(char c)) {
+  uart->base = base;
+  uart->byte_us = byte_us;
+  uart->has_cts = has_cts;
+  uart->line_start = 0;
+  uart->line_len = 0;
+  uart->line_next = 0;
+  uart->rx_start = 0;
+  uart->rx_len = 0;
+  uart->tx_done = 0;
+  uart->cts = true;
+  uart->modem_pending = false;
+  uart->modem_raised = false;
+  uart->output = output;
+  REGISTER(base + UART_DATA_OFFSET) = REGISTER_UNWRITTEN;
+  REGISTER(base + UART_FLAG_OFFSET) = CTS_MASK | RXFE_MASK;
+}
+
+static void replay_advance() {
+  if (capture_decode(replay_data, replay_len, &replay_pos, &replay_next) == 0) {
+    replay_next_time += replay_next.delta_us;
+    return;
+  }
+  replaying = false;
+  timer2_next_tick = replay_next_time + TIMER2_TICK_US;
+  fprintf(stderr, "Replay finished after %u bytes\n", replay_pos);
+}
+
+static void replay_init(long long now) {
+  const char *path = getenv("LOCAL_REPLAY");
+  replaying = false;
+  if (path == NULL) return;
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not read replay from %s\n", path);
+    return;
+  }
+  fseek(file, 0, SEEK_END);
+  replay_len = ftell(file);
+  rewind(file);
+  free(replay_data);
+  replay_data = malloc(replay_len);
+  assert(replay_data != NULL || replay_len == 0);
+  replay_len = fread(replay_data, 1, replay_len, file);
+  fclose(file);
+
+  replaying = true;
+  replay_pos = 0;
+  replay_next_time = now;
+  replay_advance();
+}
+
+static void replay_poll(long long now) {
+  while (replaying && now >= replay_next_time) {
+    if (replay_next.type == CAPTURE_TICK) {
+      timer2_ticks_owed++;
+    } else {
+      device_uart_t *uart = &uarts[replay_next.type == CAPTURE_UART1_RX ? COM1 : COM2];
+      queue_push(uart->rx, &uart->rx_start, &uart->rx_len, replay_next.c);
+    }
+    replay_advance();
+  }
+}
+
+void io_devices_init() {
+  time_init();
+  long long now = io_device_time_us();
+  uart_init(&uarts[COM1], UART1_BASE, UART1_BYTE_US, true, output_stderr);
+  uart_init(&uarts[COM2], UART2_BASE, UART2_BYTE_US, false, output_stdout);
+  REGISTER(TIMER2_BASE + CLR_OFFSET) = REGISTER_UNWRITTEN;
+  timer2_next_tick = now + TIMER2_TICK_US;
+  timer2_ticks_owed = 0;
+  keyboard_next_poll = now;
+  replay_init(now);
+}
+
+void io_device_receive(int channel, char c) {
+  // everything received comes from the capture
+  if (replaying) return;
+  device_uart_t *uart = &uarts[channel];
+  if (uart->line_len == 0) {
+    long long now = io_device_time_us();
+    uart->line_next = (uart->line_next > now ? uart->line_next : now) + uart->byte_us;
+  }
+  queue_push(uart->line, &uart->line_start, &uart->line_len, c);
+}
+
+void io_device_set_output(int channel, void (*output)(char c)) {
+  uarts[channel].output = output;
+}
+
+int io_device_can_get(int channel) {
+  return uarts[channel].rx_len > 0 ? 0 : -1;
+}
+
+int io_device_getc(int channel) {
+  device_uart_t *uart = &uarts[channel];
+  if (uart->rx_len == 0) return -1;
+  return (unsigned char) queue_pop(uart->rx, &uart->rx_start, &uart->rx_len);
+}
+
+io_time_t io_time_since_tick() {
+  return io_device_time_us() - (timer2_next_tick - TIMER2_TICK_US);
+}
+
+static void timer2_poll(long long now) {
+  // ticks aren't dropped while a task runs for longer than a tick, as
+  // nothing preempts it here, so Time() keeps up with real time
+  while (!replaying && now >= timer2_next_tick) {
+    timer2_ticks_owed++;
+    timer2_next_tick += TIMER2_TICK_US;
+  }
+  if (REGISTER(TIMER2_BASE + CLR_OFFSET) != REGISTER_UNWRITTEN) {
+    REGISTER(TIMER2_BASE + CLR_OFFSET) = REGISTER_UNWRITTEN;
+    if (timer2_ticks_owed > 0) timer2_ticks_owed--;
+  }
+}
+
+static void uart_poll(device_uart_t *uart, long long now) {
+  volatile unsigned int *data = &REGISTER(uart->base + UART_DATA_OFFSET);
+  volatile unsigned int *intr = &REGISTER(uart->base + UART_INTR_OFFSET);
+  unsigned int ctlr = REGISTER(uart->base + UART_CTLR_OFFSET);
+
+  // hwi_uart1_modem clears the modem interrupt by writing the register
+  if (uart->modem_raised && !(*intr & UART_INTR_MS)) {
+    uart->modem_pending = false;
+    uart->modem_raised = false;
+  }
+
+  if (*data != REGISTER_UNWRITTEN) {
+    char c = *data & 0xFF;
+    *data = REGISTER_UNWRITTEN;
+    uart->tx_done = now + uart->byte_us;
+    if (uart->has_cts) {
+      uart->cts = false;
+      uart->modem_pending = true;
+    }
+    uart->output(c);
+  }
+  bool tx_busy = now < uart->tx_done;
+  if (uart->has_cts && !uart->cts && !tx_busy) {
+    uart->cts = true;
+    uart->modem_pending = true;
+  }
+
+  while (uart->line_len > 0 && now >= uart->line_next) {
+    queue_push(uart->rx, &uart->rx_start, &uart->rx_len, queue_pop(uart->line, &uart->line_start, &uart->line_len));
+    uart->line_next += uart->byte_us;
+  }
+
+  unsigned int flags = 0;
+  if (uart->cts) flags |= CTS_MASK;
+  if (tx_busy) flags |= TXFF_MASK;
+  if (uart->rx_len == 0) flags |= RXFE_MASK;
+  REGISTER(uart->base + UART_FLAG_OFFSET) = flags;
+
+  unsigned int raised = 0;
+  if ((ctlr & RIEN_MASK) && uart->rx_len > 0) raised |= UART_INTR_RX;
+  if ((ctlr & TIEN_MASK) && !tx_busy && uart->cts) raised |= UART_INTR_TX;
+  if ((ctlr & MSIEN_MASK) && uart->modem_pending) {
+    raised |= UART_INTR_MS;
+    uart->modem_raised = true;
+  }
+  *intr = raised;
+}
+
+static void keyboard_poll(long long now) {
+  if (virtual_time || replaying || now < keyboard_next_poll) return;
+  keyboard_next_poll = now + KEYBOARD_POLL_US;
+  int c;
+  while ((c = getch()) != ERR) {
+    io_device_receive(COM2, c);
+  }
+}
+
+static void vic_poll() {
+  unsigned int vic1 = 0;
+  unsigned int vic2 = 0;
+  if (timer2_ticks_owed > 0) vic1 |= INTERRUPT_BIT(INTERRUPT_TIMER2);
+  if (REGISTER(UART1_BASE + UART_INTR_OFFSET)) vic2 |= INTERRUPT_BIT(INTERRUPT_UART1);
+  if (REGISTER(UART2_BASE + UART_INTR_OFFSET)) vic2 |= INTERRUPT_BIT(INTERRUPT_UART2);
+  REGISTER(VIC1_BASE + VIC_STATUS_OFFSET) = vic1 & REGISTER(VIC1_BASE + VIC_ENABLE_OFFSET);
+  REGISTER(VIC2_BASE + VIC_STATUS_OFFSET) = vic2 & REGISTER(VIC2_BASE + VIC_ENABLE_OFFSET);
+}
+
+void io_devices_poll() {
+  if (virtual_time) virtual_time_us += VIRTUAL_POLL_US;
+  long long now = io_device_time_us();
+  replay_poll(now);
+  timer2_poll(now);
+  keyboard_poll(now);
+  uart_poll(&uarts[COM1], now);
+  uart_poll(&uarts[COM2], now);
+  vic_poll();
+}
+
+void io_devices_wait() {
+  long long now = io_device_time_us();
+  long long until = replaying ? replay_next_time : timer2_next_tick;
+  for (int i = 0; i < 2; i++) {
+    if (uarts[i].tx_done > now) until = earliest(until, uarts[i].tx_done);
+    if (uarts[i].line_len > 0) until = earliest(until, uarts[i].line_next);
+  }
+  if (until <= now) return;
+
+  if (virtual_time) {
+    // nothing can happen before the next event, so skip straight to it
+    virtual_time_us = until;
+    return;
+  }
+
+  // wake up for the keyboard, in real time
+  long long sleep_us = (long long) ((until - now) / time_ratio);
+  if (sleep_us > DEVICE_WAIT_MAX_US) sleep_us = DEVICE_WAIT_MAX_US;
+  struct timespec duration;
+  duration.tv_sec = sleep_us / 1000000;
+  duration.tv_nsec = (sleep_us % 1000000) * 1000;
+  nanosleep(&duration, NULL);
+}
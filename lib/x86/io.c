@@ -23,10 +23,9 @@ void io_init() {
   // remove the buffer to prevent delaying writes
   setbuf(stdout, NULL);
   setbuf(stderr, NULL);
-}
 
-#define CLOCKS_PER_MILLISECOND (CLOCKS_PER_SEC / 1000)
-#define CLOCKS_PER_MICROSECOND (CLOCKS_PER_MILLISECOND / 1000)
+  io_devices_init();
+}
 
 void io_enable_caches() {
 
@@ -36,19 +35,25 @@ void io_disable_caches() {
 
 }
 
+// Timing values are microseconds of device time, so they follow the
+// virtual clock like Time() does
 io_time_t io_get_time() {
-  return clock();
+  return io_device_time_us();
 }
 
 unsigned int io_time_difference_ms(io_time_t current, io_time_t prev) {
-  return (current - prev) / CLOCKS_PER_MILLISECOND;
+  return (current - prev) / 1000;
+}
+
+io_time_t io_time_from_ms(unsigned int ms) {
+  return (io_time_t) ms * 1000;
 }
 
 unsigned int io_time_difference_us(io_time_t current, io_time_t prev) {
-  return (current - prev) / CLOCKS_PER_MICROSECOND;
+  return current - prev;
 }
 
-int can_put(int channel) {
+int io_can_put(int channel) {
   if (channel == COM1) {
     return 0;
   } else if (channel == COM2) {
@@ -58,7 +63,7 @@ int can_put(int channel) {
   }
 }
 
-int ts_putc(int channel, char c) {
+int io_putc(int channel, char c) {
   if (channel == COM1) {
     putc(c, stderr);
     return 0;
@@ -71,27 +76,17 @@ int ts_putc(int channel, char c) {
   return 0;
 }
 
-int can_get(int channel) {
-  if (channel == COM1) {
-    return -1;
-  } else if (channel == COM2) {
-    int ch = getch();
-    if (ch == ERR) {
-      return -1;
-    } else {
-      ungetch(ch);
-      return 0;
-    }
+int io_can_get(int channel) {
+  if (channel == COM1 || channel == COM2) {
+    return io_device_can_get(channel);
   } else {
     return -2;
   }
 }
 
-int get(int channel) {
-  if (channel == COM1) {
-    return -1;
-  } else if (channel == COM2) {
-    return getch();
+int io_getc(int channel) {
+  if (channel == COM1 || channel == COM2) {
+    return io_device_getc(channel);
   } else {
     return -2;
   }
@@ -0,0 +1,32 @@
+#include <basic.h>
+#include <debug.h>
+#include <kern/profile.h>
+
+// furthest back from a pc to look for a poked function name, in words
+#define PROFILE_MAX_SCAN 4096
+
+void profile_arch_init() {
+  // samples are taken by hwi_timer2, there is no separate profiling timer
+}
+
+uintptr_t profile_func_start(uintptr_t pc) {
+  unsigned int *word = (unsigned int *) (pc & ~3);
+  int i;
+  for (i = 0; i < PROFILE_MAX_SCAN; i++, word--) {
+    // -mpoke-function-name puts 0xff000000 + name length right before the
+    // first instruction of each function
+    if ((*word & 0xFFFFFF00) == 0xFF000000) {
+      return (uintptr_t) (word + 1);
+    }
+  }
+  return pc;
+}
+
+uintptr_t profile_func_resolve(uintptr_t func) {
+  return func;
+}
+
+const char *profile_func_name(uintptr_t func) {
+  char *name = get_func_name((unsigned int *) func);
+  return name == name_not_found ? NULL : name;
+}
@@ -0,0 +1,129 @@
+#include <stddef.h>
+#include <kassert.h>
+#include <io.h>
+
+#include <kern/budget.h>
+#include <kern/scheduler.h>
+
+budget_group_t budget_groups[MAX_BUDGET_GROUPS];
+
+void budget_init() {
+  int i;
+  for (i = 0; i < MAX_BUDGET_GROUPS; i++) {
+    budget_groups[i].in_use = false;
+    budget_groups[i].throttled = false;
+    budget_groups[i].parked = NULL;
+    budget_groups[i].parked_end = NULL;
+    budget_groups[i].throttle_events = 0;
+  }
+}
+
+int budget_create_group(unsigned int budget_ms, unsigned int period_ms) {
+  int i;
+  for (i = 0; i < MAX_BUDGET_GROUPS; i++) {
+    if (!budget_groups[i].in_use) break;
+  }
+  if (i == MAX_BUDGET_GROUPS) return -1;
+
+  budget_group_t *group = &budget_groups[i];
+  group->in_use = true;
+  group->throttled = false;
+  group->budget = io_time_from_ms(budget_ms);
+  group->used = 0;
+  group->period_ticks = period_ms / BUDGET_TICK_MS;
+  if (group->period_ticks < 1) group->period_ticks = 1;
+  group->ticks_left = group->period_ticks;
+  group->parked = NULL;
+  group->parked_end = NULL;
+  group->throttle_events = 0;
+  return i;
+}
+
+int budget_join_group(task_descriptor_t *task, int group) {
+  if (group != NO_BUDGET_GROUP && (group < 0 || group >= MAX_BUDGET_GROUPS || !budget_groups[group].in_use)) {
+    return -1;
+  }
+  if (task->is_parked) {
+    budget_unpark_task(task);
+    task->budget_group = group;
+    scheduler_requeue_task(task);
+    return 0;
+  }
+  task->budget_group = group;
+  return 0;
+}
+
+void budget_charge(task_descriptor_t *task, io_time_t time) {
+  if (task->budget_group == NO_BUDGET_GROUP) return;
+  budget_group_t *group = &budget_groups[task->budget_group];
+  group->used += time;
+  if (!group->throttled && group->used >= group->budget) {
+    group->throttled = true;
+    group->throttle_events++;
+    task->throttles++;
+  }
+}
+
+void budget_park_task(task_descriptor_t *task) {
+  budget_group_t *group = &budget_groups[task->budget_group];
+  task->next_ready_task = NULL;
+  task->is_parked = true;
+  if (group->parked == NULL) {
+    group->parked = task;
+  } else {
+    group->parked_end->next_ready_task = task;
+  }
+  group->parked_end = task;
+}
+
+void budget_unpark_task(task_descriptor_t *task) {
+  budget_group_t *group = &budget_groups[task->budget_group];
+  task_descriptor_t *prev = NULL;
+  task_descriptor_t *current = group->parked;
+  while (current != NULL && current != task) {
+    prev = current;
+    current = current->next_ready_task;
+  }
+  KASSERT(current != NULL, "Parked task not on its group's parked list. tid=%d group=%d", task->tid, task->budget_group);
+
+  if (prev == NULL) {
+    group->parked = task->next_ready_task;
+  } else {
+    prev->next_ready_task = task->next_ready_task;
+  }
+  if (group->parked_end == task) {
+    group->parked_end = prev;
+  }
+  task->next_ready_task = NULL;
+  task->is_parked = false;
+}
+
+void budget_tick() {
+  int i;
+  for (i = 0; i < MAX_BUDGET_GROUPS; i++) {
+    budget_group_t *group = &budget_groups[i];
+    if (!group->in_use) continue;
+    if (--group->ticks_left > 0) continue;
+
+    // the period ended, replenish the budget and release parked tasks
+    // time overrun in the last period is carried over as debt
+    group->ticks_left = group->period_ticks;
+    group->used = group->used > group->budget ? group->used - group->budget : 0;
+    if (group->throttled && group->used < group->budget) {
+      group->throttled = false;
+      task_descriptor_t *task = group->parked;
+      group->parked = NULL;
+      group->parked_end = NULL;
+      while (task != NULL) {
+        task_descriptor_t *next = task->next_ready_task;
+        task->next_ready_task = NULL;
+        // destroyed tasks are unparked, but never requeue one twice
+        if (task->is_parked) {
+          task->is_parked = false;
+          scheduler_requeue_task(task);
+        }
+        task = next;
+      }
+    }
+  }
+}
@@ -3,9 +3,14 @@
 #include <basic.h>
 #include <debug.h>
 #include <bwio.h>
+#include <capture.h>
 #include <jstring.h>
 #include <kern/interrupts.h>
 #include <kern/context.h>
+#include <kern/budget.h>
+#include <kern/trace.h>
+#include <kern/profile.h>
+#include <kern/flight_recorder.h>
 #include <terminal.h>
 
 extern int next_starting_task;
@@ -215,13 +220,28 @@ void print_stats() {
     if (task->state == STATE_ZOMBIE) continue;
     // Skip recyclable tasks
     if (task->is_recyclable) continue;
-    bwprintf(COM2, " Task%s %3d:%-40s %10ums (Total) %10uus (Send) %10uus (Recv) %10uus (Repl)\n\r",
+    bwprintf(COM2, " Task%s %3d:%-40s %10ums (Total) %10uus (Send) %10uus (Recv) %10uus (Repl) %6u (Preempt) %6u (Throttle) %4d (MaxSendQ)\n\r",
       task->state == STATE_ZOMBIE ? ":Z" : "  ",
       i, task->name,
       io_time_ms(task->execution_time),
       io_time_us(task->send_execution_time),
       io_time_us(task->recv_execution_time),
-      io_time_us(task->repl_execution_time)
+      io_time_us(task->repl_execution_time),
+      task->preemptions,
+      task->throttles,
+      task->max_send_queue_length
+    );
+  }
+
+  bwputstr(COM2, "Budget groups\n\r");
+  for (i = 0; i < MAX_BUDGET_GROUPS; i++) {
+    budget_group_t *group = &budget_groups[i];
+    if (!group->in_use) continue;
+    bwprintf(COM2, " Group %d: %6ums per %6ums %10u (Throttles)\n\r",
+      i,
+      io_time_ms(group->budget),
+      group->period_ticks * BUDGET_TICK_MS,
+      group->throttle_events
     );
   }
   #endif
@@ -292,7 +312,15 @@ void cleanup(bool print_stacks) {
   bwsetfifo(COM2, ON);
 
   print_logs();
+  flight_recorder_dump();
   print_stats();
+  #if KERNEL_TRACE
+  trace_dump();
+  #endif
+  capture_dump();
+  #if KERNEL_PROFILE
+  profile_dump();
+  #endif
 
   bwputstr(COM2, "\n\r" WHITE_BG BLACK_FG "===== TASK STACKS" RESET_ATTRIBUTES "\n\r");
   bwputstr(COM2, "Bug Joey to have this implemented :'(\n\t ");
@@ -0,0 +1,30 @@
+#include <basic.h>
+#include <bwio.h>
+#include <io.h>
+#include <terminal.h>
+#include <kern/context.h>
+#include <kern/flight_recorder.h>
+
+flight_record_t flight_recorder[FLIGHT_RECORDER_SIZE];
+volatile unsigned int flight_recorder_head;
+
+void flight_recorder_init() {
+  flight_recorder_head = 0;
+}
+
+void flight_recorder_dump() {
+  unsigned int head = flight_recorder_head;
+  unsigned int count = head < FLIGHT_RECORDER_SIZE ? head : FLIGHT_RECORDER_SIZE;
+  io_time_t now = io_get_time();
+  unsigned int i;
+
+  bwputstr(COM2, "\n\r" WHITE_BG BLACK_FG "===== FLIGHT RECORDER" RESET_ATTRIBUTES "\n\r");
+  bwprintf(COM2, "%u records, showing the last %u\n\r", head, count);
+  for (i = head - count; i != head; i++) {
+    flight_record_t *record = &flight_recorder[i & (FLIGHT_RECORDER_SIZE - 1)];
+    const char *name = record->tid >= 0 && record->tid < MAX_TASKS ? ctx->descriptors[record->tid].name : "kernel";
+    bwprintf(COM2, "%10dus %3d:%-20s ", -(int) io_time_us(now - record->time), record->tid, name);
+    bwprintf(COM2, (char *) record->fmt, record->args[0], record->args[1], record->args[2]);
+    bwputstr(COM2, "\n\r");
+  }
+}
@@ -5,6 +5,7 @@
 #include <kern/context.h>
 #include <kern/context_switch.h>
 #include <kern/kernel_request.h>
+#include <kern/flight_recorder.h>
 #include <kernel.h>
 #include <servers/nameserver.h>
 #include <jstring.h>
@@ -66,9 +67,9 @@ void ExitKernel( ) {
 }
 
 int Send( int tid, void *msg, int msglen, volatile void *reply, int replylen) {
-  KASSERT(tid != active_task->tid, "Attempted send to self. from_tid=%d to_tid=%d", active_task->tid, tid);
-  KASSERT(tid >= 0, "Attempted to send to a negative tid. from_tid=%d to_tid=%d", active_task->tid, tid);
-  KASSERT(((unsigned int) reply & 0x3) == 0, "Provided unaligned memory as a reply struct. Please  __attribute__ ((aligned (4))) to align it. from_tid=%d to_tid=%d", active_task->tid, tid);
+  KASSERT_DEBUG(IPC, tid != active_task->tid, "Attempted send to self. from_tid=%d to_tid=%d", active_task->tid, tid);
+  KASSERT_DEBUG(IPC, tid >= 0, "Attempted to send to a negative tid. from_tid=%d to_tid=%d", active_task->tid, tid);
+  KASSERT_DEBUG(IPC, ((unsigned int) reply & 0x3) == 0, "Provided unaligned memory as a reply struct. Please  __attribute__ ((aligned (4))) to align it. from_tid=%d to_tid=%d", active_task->tid, tid);
 
   kernel_request_t request;
   request.tid = active_task->tid;
@@ -93,7 +94,7 @@ int Receive( int *tid, volatile void *msg, int msglen ) {
   kernel_request_t request;
   request.tid = active_task->tid;
   request.syscall = SYSCALL_RECEIVE;
-  KASSERT(((unsigned int) msg & 0x3) == 0, "Provided unaligned memory as a reply struct. Please  __attribute__ ((aligned (4))) to align it.");
+  KASSERT_DEBUG(IPC, ((unsigned int) msg & 0x3) == 0, "Provided unaligned memory as a reply struct. Please  __attribute__ ((aligned (4))) to align it.");
 
   syscall_message_t ret_val;
   ret_val.msglen = msglen;
@@ -107,11 +108,11 @@ int Receive( int *tid, volatile void *msg, int msglen ) {
 
 int Reply( int tid, void *reply, int replylen ) {
   // See send for why this is commented out
-  KASSERT(tid != active_task->tid, "Attempted reply to self tid=%d", tid);
+  KASSERT_DEBUG(IPC, tid != active_task->tid, "Attempted reply to self tid=%d", tid);
   // FIXME: assert tid is valid, replylen is positive or 0
 
   // Ensure if reply is null, replylen is 0
-  KASSERT(reply != NULL || replylen == 0, "Must use size == 0 if sending NULL. got len=%d", replylen);
+  KASSERT_DEBUG(IPC, reply != NULL || replylen == 0, "Must use size == 0 if sending NULL. got len=%d", replylen);
 
   kernel_request_t request;
   request.tid = active_task->tid;
@@ -127,6 +128,81 @@ int Reply( int tid, void *reply, int replylen ) {
   return arg.status;
 }
 
+int ReplyMany( const int *tids, int count, void *reply, int replylen ) {
+  KASSERT_DEBUG(IPC, count >= 0, "ReplyMany got a negative count=%d", count);
+  KASSERT_DEBUG(IPC, reply != NULL || replylen == 0, "Must use size == 0 if sending NULL. got len=%d", replylen);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_REPLY_MANY;
+
+  syscall_reply_many_arg_t arg;
+  arg.tids = tids;
+  arg.count = count;
+  arg.msg.tid = active_task->tid;
+  arg.msg.msglen = replylen;
+  arg.msg.msg = reply;
+  request.arguments = &arg;
+
+  context_switch(&request);
+  return arg.msg.status;
+}
+
+static inline int iovec_length(const iovec_t *iov, int iovcnt) {
+  int len = 0;
+  int i;
+  for (i = 0; i < iovcnt; i++) {
+    KASSERT_DEBUG(IPC, iov[i].len >= 0 && (iov[i].base != NULL || iov[i].len == 0), "Invalid message fragment %d, len=%d", i, iov[i].len);
+    len += iov[i].len;
+  }
+  return len;
+}
+
+int SendV( int tid, const iovec_t *iov, int iovcnt, volatile void *reply, int replylen ) {
+  KASSERT_DEBUG(IPC, tid != active_task->tid, "Attempted send to self. from_tid=%d to_tid=%d", active_task->tid, tid);
+  KASSERT_DEBUG(IPC, tid >= 0, "Attempted to send to a negative tid. from_tid=%d to_tid=%d", active_task->tid, tid);
+  KASSERT_DEBUG(IPC, ((unsigned int) reply & 0x3) == 0, "Provided unaligned memory as a reply struct. Please  __attribute__ ((aligned (4))) to align it. from_tid=%d to_tid=%d", active_task->tid, tid);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_SEND_V;
+
+  syscall_message_v_t arg;
+  arg.tid = tid;
+  arg.msglen = iovec_length(iov, iovcnt);
+  arg.msg = NULL;
+  arg.iov = iov;
+  arg.iovcnt = iovcnt;
+  request.arguments = &arg;
+
+  syscall_message_t ret_val;
+  ret_val.msglen = replylen;
+  ret_val.msg = reply;
+  request.ret_val = &ret_val;
+
+  context_switch(&request);
+  return ret_val.status;
+}
+
+int ReplyV( int tid, const iovec_t *iov, int iovcnt ) {
+  KASSERT_DEBUG(IPC, tid != active_task->tid, "Attempted reply to self tid=%d", tid);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_REPLY_V;
+
+  syscall_message_v_t arg;
+  arg.tid = tid;
+  arg.msglen = iovec_length(iov, iovcnt);
+  arg.msg = NULL;
+  arg.iov = iov;
+  arg.iovcnt = iovcnt;
+  request.arguments = &arg;
+
+  context_switch(&request);
+  return arg.status;
+}
+
 int AwaitEvent( await_event_t event_type ) {
   // FIXME: assert valid event
 
@@ -135,9 +211,10 @@ int AwaitEvent( await_event_t event_type ) {
   request.syscall = SYSCALL_AWAIT;
   syscall_await_arg_t arg;
   arg.event = event_type;
+  arg.arg = 0;
   request.arguments = &arg;
   context_switch(&request);
-  return 0;
+  return (unsigned char) arg.arg;
 }
 
 int AwaitEventPut( await_event_t event_type, char ch) {
@@ -156,14 +233,33 @@ int AwaitEventPut( await_event_t event_type, char ch) {
 }
 
 io_time_t GetIdleTaskExecutionTime() {
-  int i;
-  for (i = 0; i < MAX_TASKS; i++) {
-    if (ctx->descriptors[i].priority == 31) {
-      return ctx->descriptors[i].execution_time;
-    }
-  }
-  KASSERT(false, "Could not find idle task");
-  return 0;
+  KASSERT(ctx->idle_task_tid != -1, "Could not find idle task");
+  return ctx->descriptors[ctx->idle_task_tid].execution_time;
+}
+
+io_time_t LastReceiveQueueWait() {
+  return active_task->last_queue_wait;
+}
+
+int GetStats(kernel_stats_t *stats, task_stats_t *tasks, int max_tasks) {
+  KASSERT(max_tasks >= 0, "Invalid task buffer size. max_tasks=%d", max_tasks);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_GET_STATS;
+  syscall_stats_arg_t arg;
+  arg.stats = stats;
+  arg.tasks = tasks;
+  arg.max_tasks = max_tasks;
+  request.arguments = &arg;
+  int ret_val;
+  request.ret_val = &ret_val;
+  context_switch(&request);
+  return ret_val;
+}
+
+void FlightRecord(const char *fmt, intptr_t a, intptr_t b, intptr_t c) {
+  flight_record(active_task == NULL ? KERNEL_TID : active_task->tid, fmt, a, b, c);
 }
 
 void RecordLog(const char * msg) {
@@ -204,6 +300,57 @@ void Destroy( int tid ) {
   context_switch(&request);
 }
 
+void DumpTrace( ) {
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_DUMP_TRACE;
+  context_switch(&request);
+}
+
+void SetQuantum( int priority, int ticks ) {
+  KASSERT(0 <= priority && priority < 32, "Invalid priority provided. priority=%d", priority);
+  KASSERT(ticks >= 0, "Quantum must not be negative. ticks=%d", ticks);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_SET_QUANTUM;
+  syscall_quantum_arg_t arg;
+  arg.priority = priority;
+  arg.ticks = ticks;
+  request.arguments = &arg;
+  context_switch(&request);
+}
+
+int CreateBudgetGroup( unsigned int budget_ms, unsigned int period_ms ) {
+  KASSERT(budget_ms <= period_ms, "Budget is larger than its period. budget=%ums period=%ums", budget_ms, period_ms);
+
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_BUDGET_CREATE;
+  syscall_budget_arg_t arg;
+  arg.arg1 = budget_ms;
+  arg.arg2 = period_ms;
+  request.arguments = &arg;
+  int ret_val = -1;
+  request.ret_val = &ret_val;
+  context_switch(&request);
+  return ret_val;
+}
+
+int JoinBudgetGroup( int tid, int group ) {
+  kernel_request_t request;
+  request.tid = active_task->tid;
+  request.syscall = SYSCALL_BUDGET_JOIN;
+  syscall_budget_arg_t arg;
+  arg.arg1 = tid;
+  arg.arg2 = group;
+  request.arguments = &arg;
+  int ret_val = -1;
+  request.ret_val = &ret_val;
+  context_switch(&request);
+  return ret_val;
+}
+
 void *Malloc( unsigned int size ) {
   kernel_request_t request;
   request.tid = active_task->tid;
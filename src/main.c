@@ -8,6 +8,7 @@
 #include <bwio.h>
 #include <jstring.h>
 #include <cbuffer.h>
+#include <capture.h>
 #include <io.h>
 #include <kern/globals.h>
 #include <kern/context.h>
@@ -16,6 +17,10 @@
 #include <kern/scheduler.h>
 #include <kern/task_descriptor.h>
 #include <kern/interrupts.h>
+#include <kern/budget.h>
+#include <kern/trace.h>
+#include <kern/profile.h>
+#include <kern/flight_recorder.h>
 #include <kern/syscall.h>
 #include <kernel.h>
 #include <priorities.h>
@@ -36,17 +41,19 @@ io_time_t execution_time_start;
 
 // TODO: we should track the timing for all tasks, not just the idle task
 static inline void task_pre_activate(task_descriptor_t *task) {
+  task->activations++;
   execution_time_start = io_get_time();
 }
 
 static inline void task_post_activate(task_descriptor_t *task) {
   io_time_t execution_time_end = io_get_time();
-  task->execution_time += (execution_time_end - execution_time_start);
+  io_time_t execution_time = execution_time_end - execution_time_start;
+  task->execution_time += execution_time;
+  ctx->stats.task_time += execution_time;
+  budget_charge(task, execution_time);
 }
 
 int main() {
-  char taskStack[_TaskStackSize * (MAX_TASK_STACKS + 2)];
-  TaskStack = taskStack;
   #ifndef DEBUG_MODE
   // saves FP to be able to clean exit to redboot
   asm volatile("mov %0, fp @ save fp" : "=r" (main_fp));
@@ -64,15 +71,29 @@ int main() {
   io_init();
   scheduler_init();
   interrupts_init();
+  budget_init();
+  trace_init();
+  capture_init();
+  profile_init();
+  flight_recorder_init();
 
   /* initialize core kernel global variables */
   // create shared kernel context memory
   context_t stack_context;
   stack_context.used_descriptors = 0;
   stack_context.used_stacks = 0;
+  stack_context.idle_task_tid = -1;
+  stack_context.stats.interrupt_count = 0;
+  stack_context.stats.task_time = 0;
+  for (int i = 0; i < STATS_MAX_SYSCALLS; i++) {
+    stack_context.stats.syscall_counts[i] = 0;
+  }
   for (int i = 0; i < MAX_TASKS; i++) {
     stack_context.descriptors[i].state = STATE_ZOMBIE;
     stack_context.descriptors[i].parent_tid = -1;
+    stack_context.descriptors[i].first_child = -1;
+    stack_context.descriptors[i].next_sibling = -1;
+    stack_context.descriptors[i].prev_sibling = -1;
   }
   cbuffer_init(&stack_context.freed_stacks, stack_context.freed_stacks_buffer, MAX_TASK_STACKS);
   ctx = &stack_context;
@@ -101,8 +122,18 @@ int main() {
     // was destroyed
     if (next_task->state == STATE_ZOMBIE) continue;
     KASSERT(next_task->state == STATE_READY, "Task had non-ready tid=%d state=%d", next_task->tid, next_task->state);
+    #ifdef DEBUG_MODE
+    if (interrupts_simulate(next_task)) {
+      kernel_request_t interrupt;
+      interrupt.tid = next_task->tid;
+      interrupt.syscall = SYSCALL_HW_INT;
+      handle(&interrupt);
+      continue;
+    }
+    #endif
     log_kmain("next task tid=%d", next_task->tid);
     next_starting_task = next_task->tid;
+    trace_record(TRACE_SWITCH, 0, next_task->tid, next_task->priority);
     task_pre_activate(next_task);
     kernel_request_t *request = activate(next_task);
     task_post_activate(next_task);
@@ -114,6 +145,11 @@ int main() {
 
   #ifndef DEBUG_MODE
   cleanup(false);
+  #else
+  #if KERNEL_PROFILE
+  profile_dump();
+  #endif
+  capture_dump();
   #endif
 
   bwputc(COM1, 0x61);
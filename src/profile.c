@@ -0,0 +1,100 @@
+#include <basic.h>
+#include <bwio.h>
+#include <terminal.h>
+#include <kern/context.h>
+#include <kern/profile.h>
+
+profile_bucket_t profile_buckets[PROFILE_BUCKETS];
+// samples which didn't fit in the histogram
+unsigned int profile_dropped;
+unsigned int profile_total;
+
+void profile_init() {
+  int i;
+  for (i = 0; i < PROFILE_BUCKETS; i++) {
+    profile_buckets[i].tid = PROFILE_EMPTY;
+    profile_buckets[i].samples = 0;
+  }
+  profile_dropped = 0;
+  profile_total = 0;
+  #if KERNEL_PROFILE
+  profile_arch_init();
+  #endif
+}
+
+void profile_sample(int tid, uintptr_t pc) {
+  uintptr_t func = profile_func_start(pc);
+  unsigned int hash = (func >> 2) * 31 + tid;
+  int i;
+
+  profile_total++;
+  // open addressing with linear probing, buckets are never removed
+  for (i = 0; i < PROFILE_BUCKETS; i++) {
+    profile_bucket_t *bucket = &profile_buckets[(hash + i) & (PROFILE_BUCKETS - 1)];
+    if (bucket->tid == tid && bucket->func == func) {
+      bucket->samples++;
+      return;
+    }
+    if (bucket->tid == PROFILE_EMPTY) {
+      bucket->func = func;
+      bucket->samples = 1;
+      bucket->tid = tid;
+      return;
+    }
+  }
+  profile_dropped++;
+}
+
+void profile_dump() {
+  bwputstr(COM2, "\n\r" WHITE_BG BLACK_FG "===== PROFILE" RESET_ATTRIBUTES "\n\r");
+  bwprintf(COM2, "%u samples, %u dropped\n\r", profile_total, profile_dropped);
+
+  bool printed[PROFILE_BUCKETS];
+  int i, j, tid;
+  for (i = 0; i < PROFILE_BUCKETS; i++) {
+    printed[i] = false;
+    if (profile_buckets[i].tid >= 0) {
+      profile_buckets[i].func = profile_func_resolve(profile_buckets[i].func);
+    }
+  }
+
+  // samples from several pcs may resolve to the same function. merged buckets
+  // are left as PROFILE_MERGED, so probing for later samples still works
+  for (i = 0; i < PROFILE_BUCKETS; i++) {
+    if (profile_buckets[i].tid < 0) continue;
+    for (j = i + 1; j < PROFILE_BUCKETS; j++) {
+      if (profile_buckets[j].tid != profile_buckets[i].tid || profile_buckets[j].func != profile_buckets[i].func) continue;
+      profile_buckets[i].samples += profile_buckets[j].samples;
+      profile_buckets[j].tid = PROFILE_MERGED;
+    }
+  }
+
+  for (tid = 0; tid < MAX_TASKS; tid++) {
+    unsigned int task_samples = 0;
+    for (i = 0; i < PROFILE_BUCKETS; i++) {
+      if (profile_buckets[i].tid == tid) task_samples += profile_buckets[i].samples;
+    }
+    if (task_samples == 0) continue;
+
+    bwprintf(COM2, " Task %3d:%-40s %8u samples\n\r", tid, ctx->descriptors[tid].name, task_samples);
+    // pick the largest unprinted bucket of this task, a few times
+    for (j = 0; j < PROFILE_TOP_FUNCTIONS; j++) {
+      int max = -1;
+      for (i = 0; i < PROFILE_BUCKETS; i++) {
+        if (profile_buckets[i].tid != tid || printed[i]) continue;
+        if (max == -1 || profile_buckets[i].samples > profile_buckets[max].samples) max = i;
+      }
+      if (max == -1) break;
+      printed[max] = true;
+
+      profile_bucket_t *bucket = &profile_buckets[max];
+      const char *name = profile_func_name(bucket->func);
+      bwprintf(COM2, "   %3u%% %8u  %08x %s\n\r",
+        (bucket->samples * 100) / task_samples,
+        bucket->samples,
+        (unsigned int) bucket->func,
+        name == NULL ? "" : name
+      );
+    }
+  }
+}
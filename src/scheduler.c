@@ -11,17 +11,60 @@ task_descriptor_t *ready_queues_end[MAX_PRIORITY + 1];
 
 unsigned long int priotities_ready;
 
+task_descriptor_t *handoff_task;
+
+int scheduler_quanta[MAX_PRIORITY + 1];
+
 void scheduler_init() {
   priotities_ready = 0;
+  handoff_task = NULL;
   scheduler_arch_init();
   int i;
   for (i = 0; i < MAX_PRIORITY + 1; i++) {
     ready_queues[i] = NULL;
     ready_queues_end[i] = NULL;
+    scheduler_quanta[i] = DEFAULT_QUANTUM_TICKS;
+  }
+}
+
+void scheduler_set_quantum(int priority, int ticks) {
+  scheduler_quanta[priority] = ticks;
+}
+
+void scheduler_requeue_task_front(task_descriptor_t *task) {
+  if (budget_is_throttled(task)) {
+    budget_park_task(task);
+    return;
+  }
+  if (ready_queues[task->priority] == NULL) {
+    ready_queues[task->priority] = task;
+    ready_queues_end[task->priority] = task;
+    priotities_ready |= 1 << task->priority;
+  } else {
+    task->next_ready_task = ready_queues[task->priority];
+    ready_queues[task->priority] = task;
+  }
+}
+
+void scheduler_tick(task_descriptor_t *task) {
+  int quantum = scheduler_quanta[task->priority];
+  task->quantum_used++;
+  if (quantum != 0 && task->quantum_used >= quantum) {
+    // only a preemption if a peer was waiting to take over
+    if (ready_queues[task->priority] != NULL) task->preemptions++;
+    // going to the back of the queue starts a fresh time slice
+    task->quantum_used = 0;
+    scheduler_requeue_task(task);
+  } else {
+    scheduler_requeue_task_front(task);
   }
 }
 
 void scheduler_requeue_task(task_descriptor_t *task) {
+  if (budget_is_throttled(task)) {
+    budget_park_task(task);
+    return;
+  }
   if (ready_queues[task->priority] == NULL) {
     ready_queues[task->priority] = task;
     ready_queues_end[task->priority] = task;
@@ -32,8 +75,33 @@ void scheduler_requeue_task(task_descriptor_t *task) {
   }
 }
 
+void scheduler_remove_task(task_descriptor_t *task) {
+  if (handoff_task == task) {
+    handoff_task = NULL;
+    return;
+  }
+  task_descriptor_t *prev = NULL;
+  task_descriptor_t *current = ready_queues[task->priority];
+  while (current != NULL && current != task) {
+    prev = current;
+    current = current->next_ready_task;
+  }
+  if (current == NULL) return;
+
+  if (prev == NULL) {
+    ready_queues[task->priority] = task->next_ready_task;
+  } else {
+    prev->next_ready_task = task->next_ready_task;
+  }
+  if (ready_queues_end[task->priority] == task) {
+    ready_queues_end[task->priority] = prev;
+    if (prev == NULL) priotities_ready &= ~(0x1 << task->priority);
+  }
+  task->next_ready_task = NULL;
+}
+
 int scheduler_ready_queue_size() {
-  int count = 0;
+  int count = handoff_task != NULL ? 1 : 0;
   int i;
   task_descriptor_t *current;
 
@@ -48,22 +116,34 @@ int scheduler_ready_queue_size() {
 }
 
 task_descriptor_t *scheduler_next_task() {
-  // get the lowest priority with a task
-  int next_priority = ctz(priotities_ready);
-  task_descriptor_t *next_task = ready_queues[next_priority];
-
-  // If this is null, we're screwed, other logic should
-  // check scheduler_any_task first
-  KASSERT(next_task != NULL, "There should be a next task.");
-
-  // replace the next task in the queue
-  ready_queues[next_task->priority] = next_task->next_ready_task;
-  // if this is the last task on that queue, replace the end
-  if (ready_queues_end[next_task->priority] == next_task) {
-    ready_queues_end[next_task->priority] = NULL;
-    priotities_ready &= ~(0x1 << next_task->priority);
+  // a handoff skips the ready queues entirely
+  if (handoff_task != NULL) {
+    task_descriptor_t *next_task = handoff_task;
+    handoff_task = NULL;
+    return next_task;
+  }
+
+  while (true) {
+    // get the lowest priority with a task
+    int next_priority = ctz(priotities_ready);
+    task_descriptor_t *next_task = ready_queues[next_priority];
+
+    // If this is null, we're screwed, other logic should
+    // check scheduler_any_task first
+    KASSERT(next_task != NULL, "There should be a next task.");
+
+    // replace the next task in the queue
+    ready_queues[next_task->priority] = next_task->next_ready_task;
+    // if this is the last task on that queue, replace the end
+    if (ready_queues_end[next_task->priority] == next_task) {
+      ready_queues_end[next_task->priority] = NULL;
+      priotities_ready &= ~(0x1 << next_task->priority);
+    }
+    // set this tasks next task to NULL, as it's now dequeued
+    next_task->next_ready_task = NULL;
+
+    // its group may have been throttled since it was queued
+    if (!budget_is_throttled(next_task)) return next_task;
+    budget_park_task(next_task);
   }
-  // set this tasks next task to NULL, as it's now dequeued
-  next_task->next_ready_task = NULL;
-  return next_task;
 }
@@ -3,10 +3,15 @@
 
 #include <alloc.h>
 #include <bwio.h>
+#include <capture.h>
 #include <kern/syscall.h>
 #include <kern/kernel_request.h>
 #include <kern/scheduler.h>
 #include <kern/interrupts.h>
+#include <kern/budget.h>
+#include <kern/trace.h>
+#include <kern/profile.h>
+#include <kern/flight_recorder.h>
 
 io_time_t *expected_ptr;
 io_time_t beginning_recording_time;
@@ -28,6 +33,24 @@ void syscall_handle(kernel_request_t *arg) {
 
   task->state = STATE_READY;
 
+  if (arg->syscall == SYSCALL_HW_INT) {
+    ctx->stats.interrupt_count++;
+  } else if (arg->syscall < STATS_MAX_SYSCALLS) {
+    ctx->stats.syscall_counts[arg->syscall]++;
+  }
+
+  #if KERNEL_TRACE
+  if (arg->syscall != SYSCALL_HW_INT) {
+    int target = -1;
+    if (arg->syscall == SYSCALL_SEND || arg->syscall == SYSCALL_SEND_V || arg->syscall == SYSCALL_REPLY || arg->syscall == SYSCALL_REPLY_V) {
+      target = ((syscall_message_t *) arg->arguments)->tid;
+    } else if (arg->syscall == SYSCALL_DESTROY) {
+      target = (int) arg->arguments;
+    }
+    trace_record(TRACE_SYSCALL, arg->syscall, task->tid, target);
+  }
+  #endif
+
   switch (arg->syscall) {
   case SYSCALL_MY_TID:
     syscall_my_tid(task, arg);
@@ -48,6 +71,7 @@ void syscall_handle(kernel_request_t *arg) {
     syscall_exit_kernel(task, arg);
     break;
   case SYSCALL_SEND:
+  case SYSCALL_SEND_V:
     pre_time_recording(&task->send_execution_time);
     syscall_send(task, arg);
     post_time_recording(&task->send_execution_time);
@@ -58,10 +82,16 @@ void syscall_handle(kernel_request_t *arg) {
     post_time_recording(&task->recv_execution_time);
     break;
   case SYSCALL_REPLY:
+  case SYSCALL_REPLY_V:
     pre_time_recording(&task->repl_execution_time);
     syscall_reply(task, arg);
     post_time_recording(&task->repl_execution_time);
     break;
+  case SYSCALL_REPLY_MANY:
+    pre_time_recording(&task->repl_execution_time);
+    syscall_reply_many(task, arg);
+    post_time_recording(&task->repl_execution_time);
+    break;
   case SYSCALL_AWAIT:
     syscall_await(task, arg);
     break;
@@ -74,6 +104,24 @@ void syscall_handle(kernel_request_t *arg) {
   case SYSCALL_DESTROY:
     syscall_destroy(task, arg);
     break;
+  case SYSCALL_SET_QUANTUM:
+    syscall_set_quantum(task, arg);
+    break;
+  case SYSCALL_BUDGET_CREATE:
+    syscall_budget_create(task, arg);
+    break;
+  case SYSCALL_BUDGET_JOIN:
+    syscall_budget_join(task, arg);
+    break;
+  case SYSCALL_GET_STATS:
+    syscall_get_stats(task, arg);
+    break;
+  case SYSCALL_DUMP_TRACE:
+    #if KERNEL_TRACE
+    trace_dump();
+    #endif
+    scheduler_requeue_task(task);
+    break;
   case SYSCALL_HW_INT:
     hwi(task, arg);
     break;
@@ -118,14 +166,23 @@ void syscall_malloc(task_descriptor_t *task, kernel_request_t *arg) {
   scheduler_requeue_task(task);
 }
 
+// Send queues hold descriptors, and a sender may have been destroyed since
+// it was queued, and its descriptor even reused by a new task
+static bool is_queued_sender(task_descriptor_t *sending_task, int receiver_tid) {
+  if (sending_task->state != STATE_RECEIVE_BLOCKED) return false;
+  syscall_message_t *msg = sending_task->current_request.arguments;
+  return msg->tid == receiver_tid;
+}
+
 void free_message_blocked_tasks(int tid) {
   task_descriptor_t *task = &ctx->descriptors[tid];
   // Free up the sendQ
   while (!cbuffer_empty(&task->send_queue)) {
     task_descriptor_t *sending_task = (task_descriptor_t *) cbuffer_pop(&task->send_queue, NULL);
+    if (!is_queued_sender(sending_task, tid)) continue;
     syscall_message_t *sending_task_ret = sending_task->current_request.ret_val;
     sending_task_ret->status = -3; // denotes zombie'd task
-    sending_task->state = STATE_READY;
+    td_set_state(sending_task, STATE_READY);
     scheduler_requeue_task(sending_task);
   }
 
@@ -136,7 +193,7 @@ void free_message_blocked_tasks(int tid) {
     if (task->reply_blocked_on == tid && task->state == STATE_REPLY_BLOCKED) {
       syscall_message_t *task_msg = task->current_request.ret_val;
       task_msg->status = -3;
-      task->state = STATE_READY;
+      td_set_state(task, STATE_READY);
       scheduler_requeue_task(task);
     }
   }
@@ -145,7 +202,7 @@ void free_message_blocked_tasks(int tid) {
 void syscall_destroy(task_descriptor_t *task, kernel_request_t *arg) {
   log_syscall("Destroy", task->tid);
   unsigned int tid = (unsigned int) arg->arguments;
-  // If this task is getting destroyed, it'll be skipped in main.c
+  // If this task is getting destroyed, it's taken off the ready queue below
   scheduler_requeue_task(task);
 
   void *children_buffer[MAX_TASKS];
@@ -157,15 +214,18 @@ void syscall_destroy(task_descriptor_t *task, kernel_request_t *arg) {
     int next_to_kill = (int) cbuffer_pop(&children, NULL);
     // Is the child not already dead? if so, re-allocate resources
     if (ctx->descriptors[next_to_kill].state != STATE_ZOMBIE) {
+      if (ctx->descriptors[next_to_kill].is_parked) {
+        budget_unpark_task(&ctx->descriptors[next_to_kill]);
+      } else if (ctx->descriptors[next_to_kill].state == STATE_READY) {
+        scheduler_remove_task(&ctx->descriptors[next_to_kill]);
+      }
       ctx->descriptors[next_to_kill].state = STATE_ZOMBIE;
       td_free_stack(next_to_kill);
       free_message_blocked_tasks(next_to_kill);
     }
     // We still need to recursively search for it's children
-    for (int i = 0; i < MAX_TASKS; i++) {
-      if (ctx->descriptors[i].parent_tid == next_to_kill) {
-        cbuffer_add(&children, (void *) i);
-      }
+    for (int i = ctx->descriptors[next_to_kill].first_child; i != -1; i = ctx->descriptors[i].next_sibling) {
+      cbuffer_add(&children, (void *) i);
     }
   }
 }
@@ -177,6 +237,13 @@ void syscall_free(task_descriptor_t *task, kernel_request_t *arg) {
   scheduler_requeue_task(task);
 }
 
+void syscall_set_quantum(task_descriptor_t *task, kernel_request_t *arg) {
+  syscall_quantum_arg_t *quantum_arg = arg->arguments;
+  log_syscall("SetQuantum priority=%d ticks=%d", task->tid, quantum_arg->priority, quantum_arg->ticks);
+  scheduler_set_quantum(quantum_arg->priority, quantum_arg->ticks);
+  scheduler_requeue_task(task);
+}
+
 void syscall_exit(task_descriptor_t *task, kernel_request_t *arg) {
   log_syscall("Exit", task->tid);
   // don't reschedule task
@@ -196,12 +263,9 @@ void syscall_exit_kernel(task_descriptor_t *task, kernel_request_t *arg) {
   should_exit = true;
 }
 
-void copy_msg(task_descriptor_t *src_task, task_descriptor_t *dest_task) {
-  syscall_message_t *src_msg = src_task->current_request.arguments;
-  syscall_message_t *dest_msg = dest_task->current_request.ret_val;
-
+void copy_msg_buffer(int src_tid, syscall_message_t *src_msg, syscall_message_t *dest_msg) {
   // Always let the dest_msg know the tid of the sender, even if there's a problem
-  dest_msg->tid = src_task->tid;
+  dest_msg->tid = src_tid;
 
   // short circuit conditions
   if (src_msg->msglen == 0) {
@@ -227,6 +291,35 @@ void copy_msg(task_descriptor_t *src_task, task_descriptor_t *dest_task) {
   }
 }
 
+void copy_msg_gather(int src_tid, syscall_message_v_t *src_msg, syscall_message_t *dest_msg) {
+  dest_msg->tid = src_tid;
+
+  char *dest = (char *) dest_msg->msg;
+  int remaining = dest_msg->msglen;
+  int i;
+  for (i = 0; i < src_msg->iovcnt && remaining > 0; i++) {
+    int len = src_msg->iov[i].len < remaining ? src_msg->iov[i].len : remaining;
+    jmemcpy(dest, src_msg->iov[i].base, len);
+    dest += len;
+    remaining -= len;
+  }
+
+  if (src_msg->msglen > dest_msg->msglen) {
+    dest_msg->status = -1;
+  } else {
+    dest_msg->status = src_msg->msglen;
+  }
+}
+
+void copy_msg(task_descriptor_t *src_task, task_descriptor_t *dest_task) {
+  syscall_t syscall = src_task->current_request.syscall;
+  if (syscall == SYSCALL_SEND_V || syscall == SYSCALL_REPLY_V) {
+    copy_msg_gather(src_task->tid, src_task->current_request.arguments, dest_task->current_request.ret_val);
+  } else {
+    copy_msg_buffer(src_task->tid, src_task->current_request.arguments, dest_task->current_request.ret_val);
+  }
+}
+
 
 bool is_valid_task(int tid) {
   return MAX_TASKS > tid && tid >= 0;
@@ -234,7 +327,6 @@ bool is_valid_task(int tid) {
 
 void syscall_send(task_descriptor_t *task, kernel_request_t *arg) {
   log_syscall("Send", task->tid);
-  task->state = STATE_RECEIVE_BLOCKED;
   syscall_message_t *msg = arg->arguments;
 
   // check if the target task is valid
@@ -242,7 +334,6 @@ void syscall_send(task_descriptor_t *task, kernel_request_t *arg) {
 
   if (ctx->descriptors[msg->tid].state == STATE_ZOMBIE) {
     msg->status = -3;
-    task->state = STATE_READY;
     scheduler_requeue_task(task);
     return;
   }
@@ -252,49 +343,61 @@ void syscall_send(task_descriptor_t *task, kernel_request_t *arg) {
   if (target_task->state == STATE_SEND_BLOCKED) {
     // if receiver is blocked, copy the message to them and queue them
     copy_msg(task, target_task);
-
-    // start the receiving task
-    target_task->state = STATE_READY;
-    scheduler_requeue_task(target_task);
+    target_task->messages_received++;
+    target_task->last_queue_wait = 0;
 
     // set this task to reply blocked
-    task->state = STATE_REPLY_BLOCKED;
+    td_set_state(task, STATE_REPLY_BLOCKED);
     task->reply_blocked_on = target_task->tid;
+
+    // start the receiving task, switching directly to it if we can
+    td_set_state(target_task, STATE_READY);
+    if (scheduler_can_handoff(task, target_task)) {
+      scheduler_handoff_task(target_task);
+    } else {
+      scheduler_requeue_task(target_task);
+    }
   } else {
     // if receiver is not blocked, add to their send queue
-    /* int status = */ cbuffer_add(&target_task->send_queue, task);
-    // FIXME: handle bad status of cbuffer, likely panic
+    td_set_state(task, STATE_RECEIVE_BLOCKED);
+    // holds MAX_TASKS, and a task is only ever in one send queue
+    int status = cbuffer_add(&target_task->send_queue, task);
+    KASSERT_DEBUG(IPC, status == 0, "Send queue full tid=%d target=%d", task->tid, target_task->tid);
+    int send_queue_length = cbuffer_size(&target_task->send_queue);
+    if (send_queue_length > target_task->max_send_queue_length) {
+      target_task->max_send_queue_length = send_queue_length;
+    }
   }
 }
 
 void syscall_receive(task_descriptor_t *task, kernel_request_t *arg) {
   log_syscall("Receive", task->tid);
-  task->state = STATE_SEND_BLOCKED;
 
   // if senders are blocked, get the message and continue
-  if (!cbuffer_empty(&task->send_queue)) {
-    int status;
-    task_descriptor_t *sending_task = (task_descriptor_t *) cbuffer_pop(&task->send_queue, &status);
-
-    while (sending_task->state == STATE_ZOMBIE && !cbuffer_empty(&task->send_queue)) {
-      sending_task = (task_descriptor_t *) cbuffer_pop(&task->send_queue, &status);
-    }
-
-    if (sending_task->state == STATE_ZOMBIE) {
-      RecordLogf("WARN: Zombie task sent a thing to %d/%s: %d/%s", task->tid, task->name, sending_task->tid, sending_task->name);
-      return;
+  task_descriptor_t *sending_task = NULL;
+  while (sending_task == NULL && !cbuffer_empty(&task->send_queue)) {
+    sending_task = (task_descriptor_t *) cbuffer_pop(&task->send_queue, NULL);
+    if (!is_queued_sender(sending_task, task->tid)) {
+      flight_record(task->tid, "WARN: Zombie task %d sent a thing", sending_task->tid, 0, 0);
+      sending_task = NULL;
     }
+  }
 
-    // FIXME: handle bad status of cbuffer, likely panic
-    copy_msg(sending_task, task);
+  // otherwise block until a sender comes along
+  if (sending_task == NULL) {
+    td_set_state(task, STATE_SEND_BLOCKED);
+    return;
+  }
 
-    task->state = STATE_READY;
-    scheduler_requeue_task(task);
+  copy_msg(sending_task, task);
+  task->messages_received++;
+  // the sender has been receive blocked since it was queued
+  task->last_queue_wait = io_get_time() - sending_task->state_since;
+  scheduler_requeue_task(task);
 
-    // reply block the sending task
-    sending_task->state = STATE_REPLY_BLOCKED;
-    sending_task->reply_blocked_on = task->tid;
-  }
+  // reply block the sending task
+  td_set_state(sending_task, STATE_REPLY_BLOCKED);
+  sending_task->reply_blocked_on = task->tid;
 }
 
 void syscall_reply(task_descriptor_t *task, kernel_request_t *arg) {
@@ -308,30 +411,127 @@ void syscall_reply(task_descriptor_t *task, kernel_request_t *arg) {
   if (sending_task->state == STATE_REPLY_BLOCKED && sending_task->reply_blocked_on == task->tid) {
 
     copy_msg(task, sending_task);
-    task->state = STATE_READY;
-    sending_task->state = STATE_READY;
+    td_set_state(sending_task, STATE_READY);
 
     // copy destination status over
     syscall_message_t *reply_msg = sending_task->current_request.ret_val;
     msg->status = reply_msg->status;
 
-    scheduler_requeue_task(sending_task);
-    scheduler_requeue_task(task);
+    // if the sender is more important, switch directly to it and only
+    // requeue this task
+    if (scheduler_can_handoff(task, sending_task) && sending_task->priority < task->priority) {
+      scheduler_requeue_task(task);
+      scheduler_handoff_task(sending_task);
+    } else {
+      scheduler_requeue_task(sending_task);
+      scheduler_requeue_task(task);
+    }
   } else {
     // if the target task isn't reply blocked, return -3
     msg->status = -3;
-    task->state = STATE_READY;
     scheduler_requeue_task(task);
     return;
   }
 }
 
+void syscall_reply_many(task_descriptor_t *task, kernel_request_t *arg) {
+  log_syscall("ReplyMany", task->tid);
+  syscall_reply_many_arg_t *reply_arg = arg->arguments;
+
+  int replied = 0;
+  int i;
+  for (i = 0; i < reply_arg->count; i++) {
+    int tid = reply_arg->tids[i];
+    if (!is_valid_task(tid)) continue;
+    task_descriptor_t *sending_task = &ctx->descriptors[tid];
+    if (sending_task->state != STATE_REPLY_BLOCKED || sending_task->reply_blocked_on != task->tid) continue;
+
+    copy_msg_buffer(task->tid, &reply_arg->msg, sending_task->current_request.ret_val);
+    td_set_state(sending_task, STATE_READY);
+    scheduler_requeue_task(sending_task);
+    replied++;
+  }
+
+  reply_arg->msg.status = replied;
+  scheduler_requeue_task(task);
+}
+
+void syscall_budget_create(task_descriptor_t *task, kernel_request_t *arg) {
+  syscall_budget_arg_t *budget_arg = arg->arguments;
+  log_syscall("CreateBudgetGroup budget=%dms period=%dms", task->tid, budget_arg->arg1, budget_arg->arg2);
+  *(int *) arg->ret_val = budget_create_group(budget_arg->arg1, budget_arg->arg2);
+  scheduler_requeue_task(task);
+}
+
+void syscall_budget_join(task_descriptor_t *task, kernel_request_t *arg) {
+  syscall_budget_arg_t *budget_arg = arg->arguments;
+  log_syscall("JoinBudgetGroup tid=%d group=%d", task->tid, budget_arg->arg1, budget_arg->arg2);
+  if (!is_valid_task(budget_arg->arg1) || ctx->descriptors[budget_arg->arg1].state == STATE_ZOMBIE) {
+    *(int *) arg->ret_val = -1;
+  } else {
+    *(int *) arg->ret_val = budget_join_group(&ctx->descriptors[budget_arg->arg1], budget_arg->arg2);
+  }
+  scheduler_requeue_task(task);
+}
+
+void syscall_get_stats(task_descriptor_t *task, kernel_request_t *arg) {
+  log_syscall("GetStats", task->tid);
+  syscall_stats_arg_t *stats_arg = arg->arguments;
+  int i;
+
+  if (stats_arg->stats != NULL) {
+    kernel_stats_t *stats = stats_arg->stats;
+    stats->idle_time = ctx->idle_task_tid == -1 ? 0 : ctx->descriptors[ctx->idle_task_tid].execution_time;
+    stats->task_time = ctx->stats.task_time;
+    stats->interrupt_count = ctx->stats.interrupt_count;
+    for (i = 0; i < STATS_MAX_SYSCALLS; i++) {
+      stats->syscall_counts[i] = ctx->stats.syscall_counts[i];
+    }
+    for (i = 0; i < MAX_PRIORITY + 1; i++) {
+      int length = 0;
+      task_descriptor_t *current;
+      for (current = ready_queues[i]; current != NULL; current = current->next_ready_task) {
+        length++;
+      }
+      stats->ready_queue_length[i] = length;
+    }
+    // a handoff task is ready too, it just skips the queue
+    if (handoff_task != NULL) {
+      stats->ready_queue_length[handoff_task->priority]++;
+    }
+  }
+
+  int copied = 0;
+  if (stats_arg->tasks != NULL) {
+    for (i = 0; i < MAX_TASKS && copied < stats_arg->max_tasks; i++) {
+      task_descriptor_t *current = &ctx->descriptors[i];
+      if (current->state == STATE_ZOMBIE) continue;
+      task_stats_t *task_stats = &stats_arg->tasks[copied++];
+      task_stats->tid = current->tid;
+      task_stats->priority = current->priority;
+      task_stats->state = current->state;
+      task_stats->name = current->name;
+      task_stats->execution_time = current->execution_time;
+      task_stats->activations = current->activations;
+      task_stats->messages_received = current->messages_received;
+      task_stats->send_queue_length = cbuffer_size(&current->send_queue);
+      task_stats->max_send_queue_length = current->max_send_queue_length;
+      task_stats->send_blocked_time = current->send_blocked_time;
+      task_stats->receive_blocked_time = current->receive_blocked_time;
+      task_stats->reply_blocked_time = current->reply_blocked_time;
+      task_stats->event_blocked_time = current->event_blocked_time;
+    }
+  }
+
+  *(int *) arg->ret_val = copied;
+  scheduler_requeue_task(task);
+}
+
 void syscall_await(task_descriptor_t *task, kernel_request_t *arg) {
   log_syscall("Await", task->tid);
   syscall_await_arg_t *await_arg = arg->arguments;
   await_event_t event_type = await_arg->event;
 
-  #ifndef DEBUG_MODE
   if (event_type == EVENT_UART1_RX) {
     VMEM(UART1_BASE + UART_CTLR_OFFSET) |= RIEN_MASK;
   }
@@ -344,19 +544,20 @@ void syscall_await(task_descriptor_t *task, kernel_request_t *arg) {
   if (event_type == EVENT_UART2_TX) {
     VMEM(UART2_BASE + UART_CTLR_OFFSET) |= TIEN_MASK;
   }
-  #endif
 
   interrupts_set_waiting_task(event_type, task);
 
-  task->state = STATE_EVENT_BLOCKED;
+  td_set_state(task, STATE_EVENT_BLOCKED);
 }
 
 void hwi(task_descriptor_t *task, kernel_request_t *arg) {
   task->was_interrupted = true;
 
   if (IS_INTERRUPT_ACTIVE(INTERRUPT_TIMER2)) {
+    trace_record(TRACE_INTERRUPT, TRACE_INTERRUPT_TIMER2, task->tid, 0);
     hwi_timer2(task, arg);
   } else if (IS_INTERRUPT_ACTIVE(INTERRUPT_UART1)) {
+    trace_record(TRACE_INTERRUPT, TRACE_INTERRUPT_UART1, task->tid, 0);
     if (VMEM(UART1_BASE + UART_INTR_OFFSET) & UART_INTR_RX) {
       hwi_uart1_rx(task, arg);
     }
@@ -366,25 +567,29 @@ void hwi(task_descriptor_t *task, kernel_request_t *arg) {
     if (VMEM(UART1_BASE + UART_INTR_OFFSET) & UART_INTR_MS) {
       hwi_uart1_modem(task, arg);
     }
-    scheduler_requeue_task(task);
+    // the task was only interrupted, it keeps its place in the queue
+    scheduler_requeue_task_front(task);
   } else if (IS_INTERRUPT_ACTIVE(INTERRUPT_UART2)) {
+    trace_record(TRACE_INTERRUPT, TRACE_INTERRUPT_UART2, task->tid, 0);
     if (VMEM(UART2_BASE + UART_INTR_OFFSET) & UART_INTR_RX) {
       hwi_uart2_rx(task, arg);
     } else if (VMEM(UART2_BASE + UART_INTR_OFFSET) & UART_INTR_TX) {
       hwi_uart2_tx(task, arg);
     }
-    scheduler_requeue_task(task);
+    scheduler_requeue_task_front(task);
   } else {
     log_interrupt("HWI=Unknown interrupt");
-    scheduler_requeue_task(task);
+    trace_record(TRACE_INTERRUPT, TRACE_INTERRUPT_UNKNOWN, task->tid, 0);
+    scheduler_requeue_task_front(task);
   }
 }
 
 task_descriptor_t *hwi_unblock_task_for_event(await_event_t event) {
   task_descriptor_t *event_blocked_task = interrupts_get_waiting_task(event);
   if (event_blocked_task != NULL) {
+    trace_record(TRACE_AWAKE, event, event_blocked_task->tid, 0);
     interrupts_clear_waiting_task(event);
-    event_blocked_task->state = STATE_READY;
+    td_set_state(event_blocked_task, STATE_READY);
     scheduler_requeue_task(event_blocked_task);
   }
   return event_blocked_task;
@@ -404,9 +609,22 @@ void hwi_uart2_tx(task_descriptor_t *task, kernel_request_t *arg) {
   hwi_unblock_task_for_event(EVENT_UART2_TX);
 }
 
+/**
+ * Reads the received byte for the task waiting on it. This is done in the
+ * kernel, so the capture of it can't be interrupted by a tick
+ */
+static void hwi_uart_receive(await_event_t event, int channel, int capture_type) {
+  task_descriptor_t *event_blocked_task = interrupts_get_waiting_task(event);
+  if (event_blocked_task == NULL) return;
+  syscall_await_arg_t *await_arg = event_blocked_task->current_request.arguments;
+  await_arg->arg = io_getc(channel);
+  capture_record(capture_type, await_arg->arg);
+  hwi_unblock_task_for_event(event);
+}
+
 void hwi_uart2_rx(task_descriptor_t *task, kernel_request_t *arg) {
   log_interrupt("HWI=UART 2 RX interrupt");
-  hwi_unblock_task_for_event(EVENT_UART2_RX);
+  hwi_uart_receive(EVENT_UART2_RX, COM2, CAPTURE_UART2_RX);
   VMEM(UART2_BASE + UART_CTLR_OFFSET) &= ~RIEN_MASK;
 }
 
@@ -440,13 +658,20 @@ void hwi_uart1_modem(task_descriptor_t *task, kernel_request_t *arg) {
 
 void hwi_uart1_rx(task_descriptor_t *task, kernel_request_t *arg) {
   log_interrupt("HWI=UART 1 RX interrupt");
-  hwi_unblock_task_for_event(EVENT_UART1_RX);
+  hwi_uart_receive(EVENT_UART1_RX, COM1, CAPTURE_UART1_RX);
   VMEM(UART1_BASE + UART_CTLR_OFFSET) &= ~RIEN_MASK;
 }
 
 void hwi_timer2(task_descriptor_t *task, kernel_request_t *arg) {
   log_interrupt("HWI=Timer 2 interrupt");
   hwi_unblock_task_for_event(EVENT_TIMER);
-  *((int*)(TIMER2_BASE+CLR_OFFSET)) = 0x0;
-  scheduler_requeue_task(task);
+  VMEM(TIMER2_BASE + CLR_OFFSET) = 0x0;
+  capture_record(CAPTURE_TICK, 0);
+  #if KERNEL_PROFILE && !defined(DEBUG_MODE)
+  // the interrupted pc is saved just after the spsr on the task stack
+  profile_sample(task->tid, ((unsigned int *) task->stack_pointer)[1]);
+  #endif
+  budget_tick();
+  // charge the tick to the interrupted task, which may preempt it
+  scheduler_tick(task);
 }
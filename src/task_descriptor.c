@@ -5,13 +5,16 @@
 #include <jstring.h>
 #include <kern/context.h>
 #include <kern/task_descriptor.h>
+#include <kern/budget.h>
 
 #ifndef DEBUG_MODE
 #else
 #include <stdlib.h>
 #endif
 
-char *TaskStack;
+// Static rather than on main's stack, which isn't sized for every task
+char TaskStack[_TaskStackSize * MAX_TASK_STACKS] __attribute__ ((aligned (8)));
+
 int next_free_stack(task_descriptor_t * task) {
   if (cbuffer_size(&ctx->freed_stacks) == 0) {
     return ctx->used_stacks++;
@@ -20,6 +23,34 @@ int next_free_stack(task_descriptor_t * task) {
   }
 }
 
+// Removes a task from its parent's children
+static void td_unlink_child(context_t *ctx, task_descriptor_t *task) {
+  if (task->prev_sibling != -1) {
+    ctx->descriptors[task->prev_sibling].next_sibling = task->next_sibling;
+  } else if (task->parent_tid >= 0 && ctx->descriptors[task->parent_tid].first_child == task->tid) {
+    ctx->descriptors[task->parent_tid].first_child = task->next_sibling;
+  }
+  if (task->next_sibling != -1) {
+    ctx->descriptors[task->next_sibling].prev_sibling = task->prev_sibling;
+  }
+  task->next_sibling = -1;
+  task->prev_sibling = -1;
+}
+
+// Adds a task to the children of parent_tid, which may be KERNEL_TID
+static void td_link_child(context_t *ctx, task_descriptor_t *task, int parent_tid) {
+  task->parent_tid = parent_tid;
+  task->prev_sibling = -1;
+  task->next_sibling = -1;
+  if (parent_tid < 0) return;
+  task_descriptor_t *parent = &ctx->descriptors[parent_tid];
+  task->next_sibling = parent->first_child;
+  if (parent->first_child != -1) {
+    ctx->descriptors[parent->first_child].prev_sibling = task->tid;
+  }
+  parent->first_child = task->tid;
+}
+
 task_descriptor_t *td_create(context_t *ctx, int parent_tid, int priority, void (*entrypoint)(), const char *func_name, bool is_recyclable) {
   int tid = ctx->used_descriptors;
   for (; ctx->descriptors[tid].state != STATE_ZOMBIE; tid=(tid+1)%MAX_TASKS) {
@@ -27,11 +58,19 @@ task_descriptor_t *td_create(context_t *ctx, int parent_tid, int priority, void
   }
   ctx->used_descriptors = (tid+1)%MAX_TASKS;
   task_descriptor_t *task = &ctx->descriptors[tid];
+  // Children of the task which last had this tid are handed to its parent,
+  // otherwise destroying the new task would destroy them too
+  while (task->first_child != -1) {
+    task_descriptor_t *child = &ctx->descriptors[task->first_child];
+    task->first_child = child->next_sibling;
+    td_link_child(ctx, child, task->parent_tid);
+  }
+  td_unlink_child(ctx, task);
   task->priority = priority;
   task->tid = tid;
   task->stack_id = next_free_stack(task);
   task->has_started = false;
-  task->parent_tid = parent_tid;
+  td_link_child(ctx, task, parent_tid);
   task->entrypoint = entrypoint;
   task->state = STATE_READY;
   task->next_ready_task = NULL;
@@ -39,21 +78,35 @@ task_descriptor_t *td_create(context_t *ctx, int parent_tid, int priority, void
   task->send_execution_time = 0;
   task->recv_execution_time = 0;
   task->repl_execution_time = 0;
+  task->quantum_used = 0;
+  task->preemptions = 0;
+  task->throttles = 0;
+  task->activations = 0;
+  task->messages_received = 0;
+  task->last_queue_wait = 0;
+  task->max_send_queue_length = 0;
+  task->send_blocked_time = 0;
+  task->receive_blocked_time = 0;
+  task->reply_blocked_time = 0;
+  task->event_blocked_time = 0;
+  task->state_since = 0;
+  task->budget_group = parent_tid == KERNEL_TID ? NO_BUDGET_GROUP : ctx->descriptors[parent_tid].budget_group;
+  task->is_parked = false;
   task->was_interrupted = false;
   task->is_recyclable = is_recyclable;
   jstrncpy(task->name, func_name, 128);
-  #ifndef DEBUG_MODE
+  if (priority == 31) {
+    ctx->idle_task_tid = tid;
+  }
   KASSERT(task->stack_id < MAX_TASK_STACKS, "Maximum amount of task stacks allocated stack_id=%d used_stacks=%d", task->stack_id, ctx->used_stacks);
   task->stack_pointer = TaskStack + (_TaskStackSize * task->stack_id) + _TaskStackSize * 1/* Offset, because the stack grows down */;
-  #endif
 
-  cbuffer_init(&task->send_queue, task->send_queue_buf, 100);
+  cbuffer_init(&task->send_queue, task->send_queue_buf, MAX_TASKS);
 
   return task;
 }
 
 void td_free_stack(int tid) {
-  KASSERT(tid != 5, "GETTING DEADBEEF'd %d", active_task->tid);
   ctx->descriptors[tid].stack_pointer = (void *) 0xDEADBEEF;
   cbuffer_add(&ctx->freed_stacks, (void *) ctx->descriptors[tid].stack_id);
 }
@@ -0,0 +1,26 @@
+#include <basic.h>
+#include <bwio.h>
+#include <io.h>
+#include <terminal.h>
+#include <kern/trace.h>
+
+trace_event_t trace_ring[TRACE_SIZE];
+unsigned int trace_head;
+
+void trace_init() {
+  trace_head = 0;
+}
+
+void trace_dump() {
+  unsigned int count = trace_head < TRACE_SIZE ? trace_head : TRACE_SIZE;
+  unsigned int i;
+
+  bwputstr(COM2, "\n\r" WHITE_BG BLACK_FG "===== TRACE" RESET_ATTRIBUTES "\n\r");
+  // the decoder needs the clock rate to convert times
+  bwprintf(COM2, "TRACE_BEGIN %u %u %u\n\r", count, trace_head, (unsigned int) io_time_from_ms(1000));
+  for (i = trace_head - count; i != trace_head; i++) {
+    trace_event_t *event = &trace_ring[i & (TRACE_SIZE - 1)];
+    bwprintf(COM2, "%u %d %d %d %d\n\r", (unsigned int) event->time, event->type, event->code, event->tid, event->arg);
+  }
+  bwputstr(COM2, "TRACE_END\n\r");
+}
@@ -1,22 +1,52 @@
+#include <basic.h>
+#include <io.h>
+#include <ts7200.h>
+#include <kern/context.h>
 #include <kern/interrupts.h>
 
 typedef int (*interrupt_handler)(int);
 
 void interrupts_arch_init() {
-}
+  log_interrupt("Init");
+  interrupts_clear_all();
+
+  // Enable the simulated hardware interrupts, see lib/x86/devices.c
+  log_interrupt("Enabling TIMER2 interrupts");
+  INTERRUPT_ENABLE(INTERRUPT_TIMER2);
 
+  log_interrupt("Enabling UART1 interrupts");
+  INTERRUPT_ENABLE(INTERRUPT_UART1);
+
+  log_interrupt("Enabling UART2 interrupts");
+  INTERRUPT_ENABLE(INTERRUPT_UART2);
+}
 
 void interrupts_enable_irq(await_event_t event_type) {
   if (event_type == EVENT_TIMER) {
-    // TODO: set VIC2 13th bit
+    INTERRUPT_ENABLE(INTERRUPT_TIMER2);
   }
 }
 
 void interrupts_disable_irq(await_event_t event_type) {
   if (event_type == EVENT_TIMER) {
-    // TODO: unset VIC2 13th bit
+    INTERRUPT_DISABLE(INTERRUPT_TIMER2);
   }
 }
 
 void interrupts_clear_all() {
+  // the simulated VIC has no clear register, enables are plain registers
+  VMEM(VIC1_BASE + VIC_ENABLE_OFFSET) = 0;
+  VMEM(VIC2_BASE + VIC_ENABLE_OFFSET) = 0;
+}
+
+bool interrupts_simulate(task_descriptor_t *next_task) {
+  io_devices_poll();
+  bool active = VMEM(VIC1_BASE + VIC_STATUS_OFFSET) || VMEM(VIC2_BASE + VIC_STATUS_OFFSET);
+  // nothing else can run, so sleep until a device has something to do
+  if (!active && next_task->tid == ctx->idle_task_tid) {
+    io_devices_wait();
+    io_devices_poll();
+    active = VMEM(VIC1_BASE + VIC_STATUS_OFFSET) || VMEM(VIC2_BASE + VIC_STATUS_OFFSET);
+  }
+  return active;
 }
@@ -0,0 +1,71 @@
+// for REG_RIP and dladdr
+#define _GNU_SOURCE
+
+#include <basic.h>
+#include <kern/context.h>
+#include <kern/profile.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+// profiling ticks per second of CPU time
+#define PROFILE_HZ 1000
+
+static uintptr_t profile_signal_pc(void *context) {
+  ucontext_t *uc = context;
+  #if defined(__APPLE__) && defined(__x86_64__)
+  return uc->uc_mcontext->__ss.__rip;
+  #elif defined(__APPLE__) && defined(__aarch64__)
+  return uc->uc_mcontext->__ss.__pc;
+  #elif defined(__x86_64__)
+  return uc->uc_mcontext.gregs[REG_RIP];
+  #elif defined(__i386__)
+  return uc->uc_mcontext.gregs[REG_EIP];
+  #elif defined(__aarch64__)
+  return uc->uc_mcontext.pc;
+  #else
+  return 0;
+  #endif
+}
+
+static void profile_signal_handler(int signal, siginfo_t *info, void *context) {
+  // only one thread runs at a time, and it's the kernel if there is no
+  // active task. the kernel isn't sampled, like on ARM
+  volatile task_descriptor_t *task = active_task;
+  uintptr_t pc = profile_signal_pc(context);
+  if (task == NULL || pc == 0) return;
+  profile_sample(task->tid, pc);
+}
+
+void profile_arch_init() {
+  struct sigaction action;
+  action.sa_sigaction = profile_signal_handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000 / PROFILE_HZ;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+uintptr_t profile_func_start(uintptr_t pc) {
+  // dladdr isn't safe to call from a signal handler, so samples are kept by
+  // pc until they are resolved when printed
+  return pc;
+}
+
+uintptr_t profile_func_resolve(uintptr_t func) {
+  Dl_info info;
+  if (dladdr((void *) func, &info) == 0 || info.dli_saddr == NULL) return func;
+  return (uintptr_t) info.dli_saddr;
+}
+
+const char *profile_func_name(uintptr_t func) {
+  Dl_info info;
+  if (dladdr((void *) func, &info) == 0) return NULL;
+  return info.dli_sname;
+}
@@ -1,76 +1,72 @@
 #include <basic.h>
+#include <kernel.h>
 #include <kern/context.h>
 #include <kern/scheduler.h>
 #include <kern/task_descriptor.h>
-#include <pthread.h>
+#include <ucontext.h>
 
-pthread_cond_t task_cvs[MAX_TASKS];
-bool task_started[MAX_TASKS];
-pthread_t tasks[MAX_TASKS];
-pthread_cond_t kernel_cv;
-pthread_mutex_t active_mutex;
+/**
+ * Tasks are switched in user space with swapcontext, on stacks carved from
+ * TaskStack just like on ARM. Only one task or the kernel ever runs, so
+ * switching is deterministic and there are no threads to tear down
+ */
+static ucontext_t kernel_context;
+static ucontext_t task_contexts[MAX_TASKS];
 
 void scheduler_arch_init() {
-  int i;
-  for (i = 0; i < MAX_TASKS; i++) {
-    pthread_cond_init(&task_cvs[i], NULL);
-    task_started[i] = false;
-  }
-  pthread_cond_init(&kernel_cv, NULL);
-  pthread_mutex_init(&active_mutex, NULL);
-  pthread_mutex_lock(&active_mutex);
+  log_scheduler_kern("initialized ucontext scheduler");
 }
 
 void scheduler_exit_task(task_descriptor_t *task) {
-  // cause the task thread to end
-  // WARNING: this was taken out due to it causing failure when killing a thread
-  // so for now the threads also stay alive
+  // the context is simply never resumed, and its stack is freed with the
+  // task descriptor
   task->state = STATE_ZOMBIE;
 }
 
 void scheduler_reschedule_the_world() {
-  int tid = active_task->tid;
-  task_descriptor_t *task = &ctx->descriptors[tid];
-  log_scheduler_task("signal kernel", tid);
-  pthread_cond_signal(&kernel_cv);
-  active_task = NULL;
-  if (task->state == STATE_ACTIVE) task->state = STATE_READY;
-  log_scheduler_task("cv wait", tid);
-  while (task->state != STATE_ACTIVE) pthread_cond_wait(&task_cvs[tid], &active_mutex);
-  log_scheduler_task("cv woke", tid);
+  task_descriptor_t *task = (task_descriptor_t *) active_task;
+  // save roughly where the stack is, to check for overflows like on ARM
+  task->stack_pointer = &task;
+  log_scheduler_task("swap to kernel", task->tid);
+  swapcontext(&task_contexts[task->tid], &kernel_context);
+  log_scheduler_task("resumed", task->tid);
 }
 
 void *scheduler_start_task(void *td) {
   task_descriptor_t *task = (task_descriptor_t *) td;
-  log_scheduler_task("acquire mutex", task->tid);
-  pthread_mutex_lock(&active_mutex);
+  log_scheduler_task("starting task", task->tid);
   task->entrypoint();
-
-  active_task = NULL;
-  log_scheduler_task("signal kernel (exit)", task->tid);
-  pthread_cond_signal(&kernel_cv);
-  log_scheduler_task("release mutex (exit)", task->tid);
-  pthread_mutex_unlock(&active_mutex);
-  log_scheduler_task("thread KILL", task->tid);
-  task->state = STATE_ZOMBIE;
-  pthread_exit(NULL);
-
+  // returning exits the task, as on ARM where lr is set to Exit
+  Exit();
   return NULL;
 }
 
+static void scheduler_start_active_task() {
+  scheduler_start_task((void *) active_task);
+}
+
 kernel_request_t *scheduler_activate_task(task_descriptor_t *task) {
+  // NOTE: casted to char * so we get the byte size count
+  if ((char *) task->stack_pointer < TaskStack + (_TaskStackSize * task->stack_id)) {
+    unsigned int stack_size = (_TaskStackSize * (task->stack_id + 1)) - ((char *) task->stack_pointer - TaskStack);
+    KASSERT(false, "WARNING: TASK STACK OVERFLOWED. tid=%d size=%u limit=%d", task->tid, stack_size, _TaskStackSize);
+  }
+  log_scheduler_kern("activating task tid=%d", task->tid);
   active_task = task;
-  if (!task_started[task->tid]) {
-    log_scheduler_kern("create thread tid=%d", task->tid);
-    pthread_create(&tasks[task->tid], NULL, &scheduler_start_task, task);
-    task_started[task->tid] = true;
+  ucontext_t *context = &task_contexts[task->tid];
+  if (!task->has_started) {
+    task->has_started = true;
+    getcontext(context);
+    context->uc_stack.ss_sp = TaskStack + (_TaskStackSize * task->stack_id);
+    context->uc_stack.ss_size = _TaskStackSize;
+    // tasks always Exit, so this is never followed
+    context->uc_link = &kernel_context;
+    makecontext(context, scheduler_start_active_task, 0);
   } else {
-    log_scheduler_kern("cv signal tid=%d", task->tid);
-    pthread_cond_signal(&task_cvs[task->tid]);
+    task->was_interrupted = false;
   }
-  log_scheduler_kern("cv wait for tid=%d", task->tid);
-  task->state = STATE_ACTIVE;
-  while (task->state == STATE_ACTIVE) pthread_cond_wait(&kernel_cv, &active_mutex);
-  log_scheduler_kern("cv awake after tid=%d", task->tid);
+  swapcontext(&kernel_context, context);
+  log_scheduler_kern("returned from task tid=%d", task->tid);
+  active_task = NULL;
   return &task->current_request;
 }
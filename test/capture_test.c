@@ -0,0 +1,83 @@
+#include <check.h>
+
+#include <assert.h>
+#include <capture.h>
+#include <stdio.h>
+
+START_TEST (test_capture_disabled)
+{
+  capture_start(false);
+  capture_record(CAPTURE_TICK, 0);
+  ck_assert_int_eq(capture_length, 0);
+}
+END_TEST
+
+START_TEST (test_capture_record_and_decode)
+{
+  capture_event_t event;
+  unsigned int pos = 0;
+  int result;
+
+  capture_start(true);
+  capture_record(CAPTURE_TICK, 0);
+  capture_record(CAPTURE_UART1_RX, 0x85);
+  capture_record(CAPTURE_UART2_RX, 'q');
+
+  result = capture_decode(capture_buffer, capture_length, &pos, &event);
+  ck_assert_msg(result == 0, "Error decoding tick");
+  ck_assert_int_eq(event.type, CAPTURE_TICK);
+
+  result = capture_decode(capture_buffer, capture_length, &pos, &event);
+  ck_assert_msg(result == 0, "Error decoding UART1 byte");
+  ck_assert_int_eq(event.type, CAPTURE_UART1_RX);
+  ck_assert_int_eq((unsigned char) event.c, 0x85);
+
+  result = capture_decode(capture_buffer, capture_length, &pos, &event);
+  ck_assert_msg(result == 0, "Error decoding UART2 byte");
+  ck_assert_int_eq(event.type, CAPTURE_UART2_RX);
+  ck_assert_int_eq(event.c, 'q');
+
+  ck_assert_int_eq(pos, capture_length);
+  result = capture_decode(capture_buffer, capture_length, &pos, &event);
+  ck_assert_msg(result == -1, "Decoded past the end of the capture");
+}
+END_TEST
+
+START_TEST (test_capture_decode_large_delta)
+{
+  // 10ms tick, then a cut off byte event
+  char data[] = { 0xC0, 0xB8, 0x02, 0x01 };
+  capture_event_t event;
+  unsigned int pos = 0;
+  int result;
+
+  result = capture_decode(data, sizeof(data), &pos, &event);
+  ck_assert_msg(result == 0, "Error decoding tick");
+  ck_assert_int_eq(event.type, CAPTURE_TICK);
+  ck_assert_int_eq(event.delta_us, 10000);
+
+  result = capture_decode(data, sizeof(data), &pos, &event);
+  ck_assert_msg(result == -1, "Decoded a cut off event");
+  ck_assert_int_eq(pos, 3);
+}
+END_TEST
+
+
+int main(void)
+{
+  Suite *s1 = suite_create("Core");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr = srunner_create(s1);
+  int nf;
+
+  suite_add_tcase(s1, tc);
+  tcase_add_test(tc, test_capture_disabled);
+  tcase_add_test(tc, test_capture_record_and_decode);
+  tcase_add_test(tc, test_capture_decode_large_delta);
+
+  srunner_run_all(sr, CK_NORMAL);
+  nf = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return nf == 0 ? 0 : 1;
+}
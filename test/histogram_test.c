@@ -0,0 +1,113 @@
+#include <check.h>
+
+#include <assert.h>
+#include <histogram.h>
+#include <stdio.h>
+
+START_TEST (test_histogram_empty)
+{
+  histogram_t histogram;
+  histogram_init(&histogram);
+  ck_assert_int_eq(histogram.count, 0);
+  ck_assert_int_eq(histogram_percentile(&histogram, 500), 0);
+}
+END_TEST
+
+START_TEST (test_histogram_add)
+{
+  histogram_t histogram;
+  histogram_init(&histogram);
+  histogram_add(&histogram, 0);
+  histogram_add(&histogram, 1);
+  histogram_add(&histogram, 5);
+  histogram_add(&histogram, 7);
+  histogram_add(&histogram, 1000);
+
+  ck_assert_int_eq(histogram.count, 5);
+  ck_assert_int_eq(histogram.min, 0);
+  ck_assert_int_eq(histogram.max, 1000);
+  ck_assert_int_eq(histogram.total, 1013);
+  ck_assert_int_eq(histogram.buckets[0], 1);
+  ck_assert_int_eq(histogram.buckets[1], 1);
+  // 5 and 7 are both in [4, 8)
+  ck_assert_int_eq(histogram.buckets[3], 2);
+  ck_assert_int_eq(histogram.buckets[10], 1);
+}
+END_TEST
+
+START_TEST (test_histogram_percentile)
+{
+  histogram_t histogram;
+  histogram_init(&histogram);
+  for (int i = 1; i <= 100; i++) {
+    histogram_add(&histogram, i);
+  }
+
+  // exact at the ends
+  ck_assert_int_eq(histogram_percentile(&histogram, 0), 1);
+  ck_assert_int_eq(histogram_percentile(&histogram, 1000), 100);
+  // the 50th value is in [32, 64)
+  ck_assert_int_eq(histogram_percentile(&histogram, 500), 63);
+  // the 99th value is in [64, 128), but nothing is above the max
+  ck_assert_int_eq(histogram_percentile(&histogram, 990), 100);
+}
+END_TEST
+
+START_TEST (test_histogram_merge)
+{
+  histogram_t a;
+  histogram_t b;
+  histogram_init(&a);
+  histogram_init(&b);
+  histogram_add(&a, 10);
+  histogram_add(&b, 3);
+  histogram_add(&b, 20);
+
+  histogram_merge(&a, &b);
+  ck_assert_int_eq(a.count, 3);
+  ck_assert_int_eq(a.min, 3);
+  ck_assert_int_eq(a.max, 20);
+  ck_assert_int_eq(a.total, 33);
+  ck_assert_int_eq(a.buckets[2], 1);
+  ck_assert_int_eq(a.buckets[4], 1);
+  ck_assert_int_eq(a.buckets[5], 1);
+
+  // merging an empty histogram keeps the min and max
+  histogram_init(&b);
+  histogram_merge(&a, &b);
+  ck_assert_int_eq(a.min, 3);
+  ck_assert_int_eq(a.max, 20);
+}
+END_TEST
+
+START_TEST (test_histogram_large_values)
+{
+  histogram_t histogram;
+  histogram_init(&histogram);
+  histogram_add(&histogram, 0xFFFFFFFF);
+  ck_assert_int_eq(histogram.buckets[32], 1);
+  ck_assert_msg(histogram_percentile(&histogram, 500) == 0xFFFFFFFF, "Bad percentile of the largest value");
+}
+END_TEST
+
+
+int main(void)
+{
+  Suite *s1 = suite_create("Core");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr = srunner_create(s1);
+  int nf;
+
+  suite_add_tcase(s1, tc);
+  tcase_add_test(tc, test_histogram_empty);
+  tcase_add_test(tc, test_histogram_add);
+  tcase_add_test(tc, test_histogram_percentile);
+  tcase_add_test(tc, test_histogram_merge);
+  tcase_add_test(tc, test_histogram_large_values);
+
+  srunner_run_all(sr, CK_NORMAL);
+  nf = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return nf == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <map.h>
+
+#define MAP_TEST_SIZE 8
+
+map_t map;
+map_val_t map_buf[MAP_TEST_SIZE];
+
+void test_map_init() {
+  map_buf[0].key = "stale";
+  map_init(&map, map_buf, MAP_TEST_SIZE);
+  assert(map.values == map_buf);
+  assert(map.size == 0);
+  assert(map_buf[0].key == NULL);
+}
+
+void test_map_insert_get() {
+  char *a = "a";
+  char *b = "b";
+  int va = 1;
+  int vb = 2;
+  map_init(&map, map_buf, MAP_TEST_SIZE);
+  assert(map_get(&map, a) == NULL);
+  map_insert(&map, a, &va);
+  map_insert(&map, b, &vb);
+  assert(map.size == 2);
+  assert(map_get(&map, a) == &va);
+  assert(map_get(&map, b) == &vb);
+}
+
+int main() {
+  test_map_init();
+  test_map_insert_get();
+
+  return 0;
+}
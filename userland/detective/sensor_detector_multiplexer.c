@@ -17,6 +17,8 @@ void sensor_detector_multiplexer_task() {
   cbuffer_init(&sensor_detectors, sensor_detectors_buffer, BUFFER_SIZE);
 
   int sender;
+  int detectors[BUFFER_SIZE];
+  int num_detectors;
 
   char request_buffer[128] __attribute__ ((aligned (4)));
   packet_t * packet = (packet_t *) request_buffer;
@@ -31,10 +33,11 @@ void sensor_detector_multiplexer_task() {
     case SENSOR_DATA:
       // Forward sensor data to all detectors!
       ReplyN(sender);
+      num_detectors = 0;
       while (cbuffer_size(&sensor_detectors) > 0) {
-        int detector = (int) cbuffer_pop(&sensor_detectors, NULL); // Oops, ignore the error, surely fine
-        Reply(detector, data, sizeof(sensor_data_t)); // pretty illegal send size, don't do this at home kids
+        detectors[num_detectors++] = (int) cbuffer_pop(&sensor_detectors, NULL); // Oops, ignore the error, surely fine
       }
+      ReplyMany(detectors, num_detectors, data, sizeof(sensor_data_t)); // pretty illegal send size, don't do this at home kids
       break;
     }
   }
@@ -15,6 +15,7 @@ void attrib_test_ProvideSensorTrigger(int sensor_no) {
   int tid = WhoIs(NS_SENSOR_ATTRIBUTER);
   sensor_data_t data;
   data.packet.type = SENSOR_DATA;
+  probe_clear(&data.probe);
   data.sensor_no = sensor_no;
   data.timestamp = Time();
   SendSN(tid, data);
@@ -1,14 +1,49 @@
 #include <basic.h>
 
 #include <bwio.h>
+#include <histogram.h>
+#include <idle_task.h>
+#include <priorities.h>
+#include <servers/clock_server.h>
 #include <servers/nameserver.h>
 #include <kernel.h>
 #include <ts7200.h>
 #include <io.h>
 
-#define TIMING_START(val) n = val; t2 = 0; for (i = 0; i < n; i++) { t1 = io_get_time();
-#define TIMING_LOG(msg) bwprintf(COM2, msg " cumtime=%dus ncalls=%d percall=%dus\n\r", io_time_difference_us(t2, 0), n, io_time_difference_us(t2, 0) / n)
-#define TIMING_END(msg) t2 += io_get_time() - t1; } TIMING_LOG(msg)
+/*
+ * Every benchmark records each call into a log2 histogram, and prints the
+ * min, median, 99th percentile, max and mean. Build with
+ * BENCHMARK_MACHINE=true to print them as
+ *   BENCH name=<name> n=<n> min_us=<n> p50_us=<n> p99_us=<n> max_us=<n> mean_us=<n>
+ * instead, which tools/benchmark_compare compares between two builds.
+ */
+#ifndef BENCHMARK_MACHINE
+#define BENCHMARK_MACHINE false
+#endif
+
+// Tasks in a subtree destroyed at once, including its root
+#define BENCHMARK_TREE_SIZE 8
+#define BENCHMARK_MAX_SENDERS 64
+
+#define TIMING_START(val) n = val; histogram_init(&timing); for (i = 0; i < n; i++) { t1 = io_get_time();
+#define TIMING_LOG(name, msg) timing_log(name, msg, &timing)
+#define TIMING_END(name, msg) histogram_add(&timing, io_get_time() - t1); } TIMING_LOG(name, msg)
+
+static histogram_t timing;
+static volatile bool senders_running;
+
+static void timing_log(const char *name, const char *msg, histogram_t *h) {
+  unsigned int min = io_time_difference_us(h->min, 0);
+  unsigned int median = io_time_difference_us(histogram_percentile(h, 500), 0);
+  unsigned int p99 = io_time_difference_us(histogram_percentile(h, 990), 0);
+  unsigned int max = io_time_difference_us(h->max, 0);
+  unsigned int mean = h->count == 0 ? 0 : io_time_difference_us(h->total, 0) / h->count;
+  if (BENCHMARK_MACHINE) {
+    bwprintf(COM2, "BENCH name=%s n=%d min_us=%d p50_us=%d p99_us=%d max_us=%d mean_us=%d\n\r", name, h->count, min, median, p99, max, mean);
+  } else {
+    bwprintf(COM2, "%s ncalls=%d min=%dus median=%dus p99=%dus max=%dus mean=%dus\n\r", msg, h->count, min, median, p99, max, mean);
+  }
+}
 
 void msg_child_task() {
   int from_tid;
@@ -30,6 +65,27 @@ void timing_start_task() {
   Exit();
 }
 
+void blocked_task() {
+  int from_tid;
+  Receive(&from_tid, NULL, 0);
+  Exit();
+}
+
+void subtree_task() {
+  for (int i = 1; i < BENCHMARK_TREE_SIZE; i++) {
+    Create(0, &blocked_task);
+  }
+  blocked_task();
+}
+
+void queued_sender_task() {
+  int parent_tid = MyParentTid();
+  while (senders_running) {
+    Send(parent_tid, NULL, 0, NULL, 0);
+  }
+  Exit();
+}
+
 void hello_recv_child_task() {
   int from_tid;
   char buf[6];
@@ -44,6 +100,27 @@ void hello_recv_child_task() {
   Exit();
 }
 
+// Receive and Reply with depth senders always waiting
+static void benchmark_send_queue(int depth, const char *name, const char *msg) {
+  int i, n;
+  io_time_t t1;
+  int from_tid;
+  senders_running = true;
+  for (i = 0; i < depth; i++) {
+    Create(1, &queued_sender_task);
+  }
+  TIMING_START(100);
+  Receive(&from_tid, NULL, 0);
+  Reply(from_tid, NULL, 0);
+  TIMING_END(name, msg);
+  // let every sender see it's over and exit
+  senders_running = false;
+  for (i = 0; i < depth; i++) {
+    Receive(&from_tid, NULL, 0);
+    Reply(from_tid, NULL, 0);
+  }
+}
+
 void benchmark_entry_task() {
   int from_task;
   int new_task_id;
@@ -71,36 +148,98 @@ void benchmark_entry_task() {
   new_task_id = Create(2, &msg_child_task);
   TIMING_START(100);
   Send(new_task_id, msg_4, 4, NULL, 0);
-  TIMING_END("4 byte message SRR");
+  TIMING_END("srr_4", "4 byte message SRR");
 
   new_task_id = Create(2, &msg_child_task);
   TIMING_START(100);
   Send(new_task_id, msg_64, 64, NULL, 0);
-  TIMING_END("64 byte message SRR");
+  TIMING_END("srr_64", "64 byte message SRR");
 
   new_task_id = Create(0, &msg_child_task);
   TIMING_START(100);
   Send(new_task_id, msg_4, 4, NULL, 0);
-  TIMING_END("4 byte message RSR");
+  TIMING_END("rsr_4", "4 byte message RSR");
 
   new_task_id = Create(0, &msg_child_task);
   TIMING_START(100);
   Send(new_task_id, msg_64, 64, NULL, 0);
-  TIMING_END("64 byte message RSR");
+  TIMING_END("rsr_64", "64 byte message RSR");
 
-  TIMING_START(1);
+  TIMING_START(100);
   Create(0, &empty_task);
-  TIMING_END("Task start, enter, exit");
+  TIMING_END("create_exit", "Task start, enter, exit");
 
   t1 = io_get_time();
   new_task_id = Create(0, &timing_start_task);
   Receive(&from_task, &t2, sizeof(io_time_t));
   Reply(from_task, NULL, 0);
-  bwprintf(COM2, "Task start and enter time=%dus\n\r", io_time_difference_us(t2, t1));
+  histogram_init(&timing);
+  histogram_add(&timing, t2 - t1);
+  TIMING_LOG("create_enter", "Task start and enter");
 
   TIMING_START(100);
   Pass();
-  TIMING_END("Task reschedule");
+  TIMING_END("pass", "Task reschedule");
+
+  n = 20;
+  histogram_init(&timing);
+  for (i = 0; i < n; i++) {
+    new_task_id = Create(1, &subtree_task);
+    t1 = io_get_time();
+    Destroy(new_task_id);
+    histogram_add(&timing, io_get_time() - t1);
+  }
+  TIMING_LOG("destroy_subtree", "Destroy subtree of 8 tasks");
+
+  histogram_t free_timing;
+  histogram_init(&timing);
+  histogram_init(&free_timing);
+  for (i = 0; i < 100; i++) {
+    t1 = io_get_time();
+    void *ptr = Malloc(64);
+    t2 = io_get_time();
+    Free(ptr);
+    histogram_add(&timing, t2 - t1);
+    histogram_add(&free_timing, io_get_time() - t2);
+  }
+  TIMING_LOG("malloc_64", "Malloc 64 bytes");
+  timing_log("free_64", "Free 64 bytes", &free_timing);
+
+  benchmark_send_queue(1, "send_queue_1", "Receive, Reply with 1 waiting sender");
+  benchmark_send_queue(8, "send_queue_8", "Receive, Reply with 8 waiting senders");
+  benchmark_send_queue(BENCHMARK_MAX_SENDERS, "send_queue_64", "Receive, Reply with 64 waiting senders");
+
+  // Only this task waits for ticks until the clock server starts
+  Create(PRIORITY_IDLE_TASK, &idle_task);
+  AwaitEvent(EVENT_TIMER);
+  n = 100;
+  histogram_init(&timing);
+  for (i = 0; i < n; i++) {
+    AwaitEvent(EVENT_TIMER);
+    histogram_add(&timing, io_time_since_tick());
+  }
+  TIMING_LOG("await_timer", "Timer interrupt to AwaitEvent return");
+
+  Create(PRIORITY_NAMESERVER, &nameserver);
+  Create(PRIORITY_CLOCK_SERVER, &clock_server);
+
+  TIMING_START(100);
+  WhoIs(NS_NAMESERVER);
+  TIMING_END("whois", "WhoIs");
+
+  // How far each Delay(1) wakes up from a tick after the last
+  io_time_t tick = io_time_from_ms(10);
+  Delay(1);
+  t2 = io_get_time();
+  n = 100;
+  histogram_init(&timing);
+  for (i = 0; i < n; i++) {
+    Delay(1);
+    t1 = io_get_time();
+    histogram_add(&timing, t1 - t2 > tick ? t1 - t2 - tick : tick - (t1 - t2));
+    t2 = t1;
+  }
+  TIMING_LOG("delay_jitter", "Delay(1) jitter");
 
   // Sanity check SRR, prints result value
   bwprintf(COM2, "=== SANITY CHECK ===\n\r");
@@ -0,0 +1,354 @@
+#include <basic.h>
+#include <bwio.h>
+#include <histogram.h>
+#include <idle_task.h>
+#include <io.h>
+#include <jstring.h>
+#include <kernel.h>
+#include <kern/context.h>
+#include <priorities.h>
+#include <servers/clock_server.h>
+#include <servers/nameserver.h>
+#include <worker.h>
+
+/**
+ * IPC load generator
+ *
+ * Runs every topology with 1, 2, 4, ... tasks for LOAD_DURATION_TICKS
+ * each, and last with as many tasks as there are stacks for. Prints a line
+ * per run:
+ *   LOAD topology=<name> tasks=<n> msgs=<n> msgs_per_s=<n> p50_us=<n>
+ *        p99_us=<n> max_us=<n> samples=<n> kernel_ns_per_msg=<n>
+ *
+ * Messages are every Send in the run. Latency is from Send to Reply for
+ * a client, around the whole chain for chain, a whole round for fan, and
+ * from Create to Destroy for churn. The kernel overhead is the time not
+ * spent in any task, per message.
+ *
+ *   n_to_1  n clients Send to one server
+ *   chain   a client Sends through n relays, each forwarding to the next
+ *   fan     a master hands work to n workers at once, and collects it all
+ *   mixed   n clients at 4 priorities Send to one server, with a line per
+ *           priority as well. Each client waits a tick after every
+ *           LOAD_MIXED_BURST messages, so lower priorities get to run until
+ *           the higher ones take up all of it. These Delays are counted as
+ *           messages too
+ *   churn   n spawners Create a child, which Sends to it once, and then
+ *           Destroy it
+ */
+
+#define LOAD_DURATION_TICKS 100
+#define LOAD_MESSAGE_SIZE 16
+#define LOAD_MIXED_PRIORITIES 4
+#define LOAD_MIXED_BURST 16
+// nameserver, clock server and notifier, idle task, and this task
+#define LOAD_SYSTEM_TASKS 5
+// stacks left for the tasks of a run
+#define LOAD_TASKS_MAX (MAX_TASK_STACKS - LOAD_SYSTEM_TASKS)
+
+// Below the entry task, so it can always stop a run
+#define PRIORITY_LOAD_SERVER 20
+#define PRIORITY_LOAD_CLIENT 21
+
+typedef enum {
+  LOAD_N_TO_1,
+  LOAD_CHAIN,
+  LOAD_FAN,
+  LOAD_MIXED,
+  LOAD_CHURN,
+  LOAD_NUM_TOPOLOGIES,
+} load_topology_t;
+
+static const char *load_topology_names[LOAD_NUM_TOPOLOGIES] = {
+  "n_to_1",
+  "chain",
+  "fan",
+  "mixed",
+  "churn",
+};
+
+typedef struct {
+  // into load_latency
+  int index;
+  // the server, first relay, or nothing
+  int target;
+  // of churned children, the number of fan workers, or messages a client
+  // sends before waiting a tick (0 to never wait)
+  int arg;
+} load_client_t;
+
+static volatile bool load_running;
+// one per client, so preempted clients can't lose samples
+static histogram_t load_latency[LOAD_TASKS_MAX];
+
+/**
+ * Blocks until every task of the run has been created. Otherwise a running
+ * client can starve a lower priority worker before it gets its data,
+ * and the entry task with it, see worker.h
+ */
+static void load_wait_for_start(int parent_tid) {
+  Send(parent_tid, NULL, 0, NULL, 0);
+}
+
+static void load_server() {
+  char msg[LOAD_MESSAGE_SIZE];
+  int sender;
+  while (true) {
+    Receive(&sender, msg, sizeof(msg));
+    Reply(sender, msg, sizeof(msg));
+  }
+}
+
+static void load_relay(int parent_tid, void *data) {
+  int next = *(int *) data;
+  char msg[LOAD_MESSAGE_SIZE];
+  int sender;
+  while (true) {
+    Receive(&sender, msg, sizeof(msg));
+    Send(next, msg, sizeof(msg), msg, sizeof(msg));
+    Reply(sender, msg, sizeof(msg));
+  }
+}
+
+static void load_client(int parent_tid, void *data) {
+  load_client_t *client = (load_client_t *) data;
+  histogram_t *latency = &load_latency[client->index];
+  char msg[LOAD_MESSAGE_SIZE];
+  int sent = 0;
+  load_wait_for_start(parent_tid);
+  while (load_running) {
+    io_time_t start = io_get_time();
+    Send(client->target, msg, sizeof(msg), msg, sizeof(msg));
+    histogram_add(latency, io_get_time() - start);
+    if (client->arg > 0 && ++sent % client->arg == 0) Delay(1);
+  }
+  Send(parent_tid, NULL, 0, NULL, 0);
+}
+
+static void load_fan_worker(int parent_tid, void *data) {
+  char msg[LOAD_MESSAGE_SIZE];
+  while (true) {
+    Send(parent_tid, msg, sizeof(msg), msg, sizeof(msg));
+  }
+}
+
+static void load_fan_master(int parent_tid, void *data) {
+  load_client_t *client = (load_client_t *) data;
+  histogram_t *latency = &load_latency[client->index];
+  int my_tid = MyTid();
+  int workers[LOAD_TASKS_MAX];
+  char msg[LOAD_MESSAGE_SIZE];
+  for (int i = 0; i < client->arg; i++) {
+    CreateWorker(PRIORITY_LOAD_CLIENT, load_fan_worker, my_tid);
+  }
+  load_wait_for_start(parent_tid);
+  while (load_running) {
+    io_time_t start = io_get_time();
+    // fan in, then fan out the next piece of work to everyone at once
+    for (int i = 0; i < client->arg; i++) {
+      Receive(&workers[i], msg, sizeof(msg));
+    }
+    ReplyMany(workers, client->arg, msg, sizeof(msg));
+    histogram_add(latency, io_get_time() - start);
+  }
+  Send(parent_tid, NULL, 0, NULL, 0);
+}
+
+static void load_churn_child() {
+  Send(MyParentTid(), NULL, 0, NULL, 0);
+  // nothing sends to this, so it waits to be destroyed
+  int sender;
+  Receive(&sender, NULL, 0);
+}
+
+static void load_spawner(int parent_tid, void *data) {
+  load_client_t *client = (load_client_t *) data;
+  histogram_t *latency = &load_latency[client->index];
+  int sender;
+  load_wait_for_start(parent_tid);
+  while (load_running) {
+    io_time_t start = io_get_time();
+    int child = Create(client->arg, load_churn_child);
+    Receive(&sender, NULL, 0);
+    ReplyN(sender);
+    Destroy(child);
+    histogram_add(latency, io_get_time() - start);
+  }
+  Send(parent_tid, NULL, 0, NULL, 0);
+}
+
+static int load_tasks_needed(load_topology_t topology, int n) {
+  switch (topology) {
+  case LOAD_CHAIN:
+    // the server and the client
+    return n + 2;
+  case LOAD_CHURN:
+    // a child for every spawner
+    return 2 * n;
+  default:
+    // the server or fan master
+    return n + 1;
+  }
+}
+
+// The largest n which fits in LOAD_TASKS_MAX
+static int load_max_n(load_topology_t topology) {
+  int n = 1;
+  while (load_tasks_needed(topology, n + 1) <= LOAD_TASKS_MAX) n++;
+  return n;
+}
+
+/**
+ * Creates the tasks of a run
+ * @param  tids created by this task, to destroy after (OUTPUT)
+ * @return      the number of tids
+ */
+static int load_create(load_topology_t topology, int n, int *tids) {
+  load_client_t client;
+  client.target = -1;
+  client.arg = 0;
+  int count = 0;
+  switch (topology) {
+  case LOAD_N_TO_1:
+  case LOAD_MIXED:
+    client.target = tids[count++] = Create(PRIORITY_LOAD_SERVER, load_server);
+    if (topology == LOAD_MIXED) client.arg = LOAD_MIXED_BURST;
+    for (int i = 0; i < n; i++) {
+      int priority = PRIORITY_LOAD_CLIENT;
+      if (topology == LOAD_MIXED) priority += i % LOAD_MIXED_PRIORITIES;
+      client.index = i;
+      tids[count++] = CreateWorker(priority, load_client, client);
+    }
+    break;
+  case LOAD_CHAIN:
+    // built from the end, so each relay knows the next
+    client.target = tids[count++] = Create(PRIORITY_LOAD_SERVER, load_server);
+    for (int i = 0; i < n; i++) {
+      client.target = tids[count++] = CreateWorker(PRIORITY_LOAD_SERVER, load_relay, client.target);
+    }
+    client.index = 0;
+    tids[count++] = CreateWorker(PRIORITY_LOAD_CLIENT, load_client, client);
+    break;
+  case LOAD_FAN:
+    client.index = 0;
+    client.arg = n;
+    tids[count++] = CreateWorker(PRIORITY_LOAD_SERVER, load_fan_master, client);
+    break;
+  case LOAD_CHURN:
+    client.arg = PRIORITY_LOAD_SERVER;
+    for (int i = 0; i < n; i++) {
+      client.index = i;
+      tids[count++] = CreateWorker(PRIORITY_LOAD_CLIENT, load_spawner, client);
+    }
+    break;
+  default:
+    KASSERT(false, "Unknown load topology=%d", topology);
+    break;
+  }
+  return count;
+}
+
+// Tasks which wait for the run to start, and report back when it stops
+static int load_reporters(load_topology_t topology, int n) {
+  switch (topology) {
+  case LOAD_N_TO_1:
+  case LOAD_MIXED:
+  case LOAD_CHURN:
+    return n;
+  default:
+    return 1;
+  }
+}
+
+static unsigned int load_messages(kernel_stats_t *stats) {
+  return stats->syscall_counts[SYSCALL_SEND] + stats->syscall_counts[SYSCALL_SEND_V];
+}
+
+static void load_print(const char *topology, const char *suffix, int n, unsigned int msgs, unsigned int elapsed_us, unsigned int kernel_us, histogram_t *latency) {
+  unsigned int elapsed_ms = elapsed_us / 1000;
+  unsigned int msgs_per_s = elapsed_ms == 0 ? 0 : (msgs / elapsed_ms) * 1000 + ((msgs % elapsed_ms) * 1000) / elapsed_ms;
+  unsigned int kernel_ns_per_msg = msgs == 0 ? 0 : (kernel_us * 1000) / msgs;
+  bwprintf(COM2, "LOAD topology=%s%s tasks=%d msgs=%u msgs_per_s=%u p50_us=%u p99_us=%u max_us=%u samples=%u kernel_ns_per_msg=%u\n\r",
+    topology, suffix, n, msgs, msgs_per_s,
+    io_time_difference_us(histogram_percentile(latency, 500), 0),
+    io_time_difference_us(histogram_percentile(latency, 990), 0),
+    io_time_difference_us(latency->max, 0),
+    latency->count, kernel_ns_per_msg);
+}
+
+static void load_run(load_topology_t topology, int n) {
+  int tids[LOAD_TASKS_MAX + 2];
+  kernel_stats_t before;
+  kernel_stats_t after;
+
+  int reporters[LOAD_TASKS_MAX];
+  int num_reporters = load_reporters(topology, n);
+
+  for (int i = 0; i < LOAD_TASKS_MAX; i++) {
+    histogram_init(&load_latency[i]);
+  }
+  int count = load_create(topology, n, tids);
+  for (int i = 0; i < num_reporters; i++) {
+    Receive(&reporters[i], NULL, 0);
+  }
+
+  load_running = true;
+  GetStats(&before, NULL, 0);
+  io_time_t start = io_get_time();
+  ReplyMany(reporters, num_reporters, NULL, 0);
+  Delay(LOAD_DURATION_TICKS);
+  io_time_t end = io_get_time();
+  GetStats(&after, NULL, 0);
+
+  load_running = false;
+  int sender;
+  for (int i = 0; i < num_reporters; i++) {
+    Receive(&sender, NULL, 0);
+    ReplyN(sender);
+  }
+  for (int i = 0; i < count; i++) {
+    Destroy(tids[i]);
+  }
+
+  unsigned int msgs = load_messages(&after) - load_messages(&before);
+  unsigned int elapsed_us = io_time_difference_us(end, start);
+  unsigned int task_us = io_time_difference_us(after.task_time - before.task_time, 0);
+  unsigned int kernel_us = elapsed_us > task_us ? elapsed_us - task_us : 0;
+
+  histogram_t latency;
+  histogram_init(&latency);
+  for (int i = 0; i < LOAD_TASKS_MAX; i++) {
+    histogram_merge(&latency, &load_latency[i]);
+  }
+  load_print(load_topology_names[topology], "", n, msgs, elapsed_us, kernel_us, &latency);
+
+  if (topology == LOAD_MIXED) {
+    // the same run, split by the priority of the clients
+    for (int p = 0; p < LOAD_MIXED_PRIORITIES && p < n; p++) {
+      char suffix[8];
+      jformatf(suffix, sizeof(suffix), "_p%d", PRIORITY_LOAD_CLIENT + p);
+      histogram_init(&latency);
+      for (int i = p; i < n; i += LOAD_MIXED_PRIORITIES) {
+        histogram_merge(&latency, &load_latency[i]);
+      }
+      load_print(load_topology_names[topology], suffix, n, msgs, elapsed_us, kernel_us, &latency);
+    }
+  }
+}
+
+void ipc_load_entry_task() {
+  Create(PRIORITY_NAMESERVER, nameserver);
+  Create(PRIORITY_CLOCK_SERVER, clock_server);
+  Create(PRIORITY_IDLE_TASK, idle_task);
+
+  bwprintf(COM2, "=== IPC LOAD ===\n\r");
+  for (int topology = 0; topology < LOAD_NUM_TOPOLOGIES; topology++) {
+    int max_n = load_max_n(topology);
+    for (int n = 1; n < max_n; n *= 2) {
+      load_run(topology, n);
+    }
+    load_run(topology, max_n);
+  }
+  bwprintf(COM2, "=== IPC LOAD DONE ===\n\r");
+  ExitKernel();
+}
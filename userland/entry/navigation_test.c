@@ -41,6 +41,7 @@ void ProvideSensorTrigger(int sensor_no) {
   int tid = WhoIs(NS_SENSOR_ATTRIBUTER);
   sensor_data_t data;
   data.packet.type = SENSOR_DATA;
+  probe_clear(&data.probe);
   data.sensor_no = sensor_no;
   data.timestamp = ticker++;
   SendSN(tid, data);
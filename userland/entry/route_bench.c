@@ -0,0 +1,190 @@
+#include <basic.h>
+#include <bwio.h>
+#include <histogram.h>
+#include <idle_task.h>
+#include <io.h>
+#include <kernel.h>
+#include <priorities.h>
+#include <servers/clock_server.h>
+#include <servers/nameserver.h>
+#include <servers/uart_tx_server.h>
+#include <track/pathing.h>
+#include <trains/navigation.h>
+#include <trains/reservoir.h>
+#include <trains/switch_controller.h>
+#include <trains/train_controller.h>
+
+/**
+ * Routing and reservation benchmarks
+ *
+ * Times the routing a train controller does on tracks A and B, with each
+ * call recorded into a histogram, and prints for each
+ *   BENCH name=<track>_<op> n=<n> min_us=<n> p50_us=<n> p99_us=<n> max_us=<n> mean_us=<n>
+ * like the BENCHMARK entry, so tools/benchmark_compare works on both.
+ *
+ *   init_sensor_distances  initSensorDistances, as done at startup
+ *   dijkstra               every source to every destination
+ *   get_path               GetPathWithResv, every source to every destination
+ *   find_sensor_or_branch  from every node
+ *   next_sensor            from every node, following the switches
+ *   switch_state           a GetSwitchState, the messaging next_sensor does
+ *   reserve_build          next_segments_offset from every sensor, with the
+ *                          switch states read before
+ *   reserve_lookup         the same, asking the switch controller at each
+ *                          switch like train controllers do
+ *   reserve_request        requesting those, releasing the last ones
+ *
+ * reserve_build is the routing of reserve_next_segments_offset, which train
+ * controllers do on every sensor they hit, and reserve_lookup and
+ * reserve_request are the messaging added to it.
+ *
+ * A ROUTE line per track gives how many segments are reserved from each
+ * sensor, and over_limit, how many sensors had more ahead than the reservoir
+ * takes at once, so a train there can't reserve its way forward.
+ */
+
+#define ROUTE_INIT_RUNS 5
+// from the calibrated trains, slow and fast, for few and many segments
+#define ROUTE_TRAINS 2
+static const int route_trains[ROUTE_TRAINS][2] = { {70, 5}, {63, 13} };
+
+static volatile int route_sink;
+
+static void route_log(const char *track_name, const char *name, histogram_t *h) {
+  unsigned int mean = h->count == 0 ? 0 : io_time_difference_us(h->total, 0) / h->count;
+  bwprintf(COM2, "BENCH name=%s_%s n=%d min_us=%d p50_us=%d p99_us=%d max_us=%d mean_us=%d\n\r",
+    track_name, name, h->count,
+    io_time_difference_us(h->min, 0),
+    io_time_difference_us(histogram_percentile(h, 500), 0),
+    io_time_difference_us(histogram_percentile(h, 990), 0),
+    io_time_difference_us(h->max, 0),
+    mean);
+}
+
+static bool is_node(int node) {
+  return track[node].type != NODE_NONE;
+}
+
+static void route_bench_track(const char *track_name, void (*init_track)(track_node *)) {
+  histogram_t timing;
+  histogram_t other;
+  io_time_t start;
+  path_t path;
+
+  init_track(track);
+
+  histogram_init(&timing);
+  for (int i = 0; i < ROUTE_INIT_RUNS; i++) {
+    start = io_get_time();
+    initSensorDistances();
+    histogram_add(&timing, io_get_time() - start);
+  }
+  route_log(track_name, "init_sensor_distances", &timing);
+
+  histogram_init(&timing);
+  histogram_init(&other);
+  for (int src = 0; src < TRACK_MAX; src++) {
+    if (!is_node(src)) continue;
+    for (int dest = 0; dest < TRACK_MAX; dest++) {
+      if (!is_node(dest)) continue;
+      start = io_get_time();
+      dijkstra(src, dest, 0, -1);
+      histogram_add(&timing, io_get_time() - start);
+
+      start = io_get_time();
+      GetPathWithResv(&path, src, dest, -1);
+      histogram_add(&other, io_get_time() - start);
+    }
+  }
+  route_log(track_name, "dijkstra", &timing);
+  route_log(track_name, "get_path", &other);
+
+  histogram_init(&timing);
+  histogram_init(&other);
+  for (int node = 0; node < TRACK_MAX; node++) {
+    if (!is_node(node)) continue;
+    start = io_get_time();
+    route_sink = findSensorOrBranch(node).node;
+    histogram_add(&timing, io_get_time() - start);
+
+    start = io_get_time();
+    route_sink = nextSensor(node).node;
+    histogram_add(&other, io_get_time() - start);
+  }
+  route_log(track_name, "find_sensor_or_branch", &timing);
+  route_log(track_name, "next_sensor", &other);
+
+  histogram_init(&timing);
+  for (int node = 0; node < TRACK_MAX; node++) {
+    if (track[node].type != NODE_BRANCH) continue;
+    start = io_get_time();
+    route_sink = GetSwitchState(track[node].num);
+    histogram_add(&timing, io_get_time() - start);
+  }
+  route_log(track_name, "switch_state", &timing);
+
+  int switch_states[NUM_SWITCHES];
+  for (int node = 0; node < TRACK_MAX; node++) {
+    if (track[node].type != NODE_BRANCH) continue;
+    switch_states[switch_to_index(track[node].num)] = GetSwitchState(track[node].num);
+  }
+
+  histogram_t segments;
+  histogram_t lookup;
+  int over_limit = 0;
+  reservoir_segment_edges_t reserving;
+  histogram_init(&timing);
+  histogram_init(&lookup);
+  histogram_init(&other);
+  histogram_init(&segments);
+  for (int t = 0; t < ROUTE_TRAINS; t++) {
+    int train = route_trains[t][0];
+    int speed = route_trains[t][1];
+    // sensors in order, like a train going around hitting each
+    for (int sensor = 0; sensor < TRACK_MAX; sensor++) {
+      if (track[sensor].type != NODE_SENSOR) continue;
+      start = io_get_time();
+      next_segments_offset(&reserving, train, speed, sensor, 0, NULL);
+      histogram_add(&lookup, io_get_time() - start);
+
+      start = io_get_time();
+      int len = next_segments_offset(&reserving, train, speed, sensor, 0, switch_states);
+      histogram_add(&timing, io_get_time() - start);
+      // there's always an edge ahead of a sensor, so this is too many segments
+      if (len == -1) {
+        over_limit++;
+        continue;
+      }
+      histogram_add(&segments, len);
+
+      start = io_get_time();
+      RequestSegmentEdgesAndReleaseRest(&reserving);
+      histogram_add(&other, io_get_time() - start);
+    }
+  }
+  route_log(track_name, "reserve_build", &timing);
+  route_log(track_name, "reserve_lookup", &lookup);
+  route_log(track_name, "reserve_request", &other);
+  bwprintf(COM2, "ROUTE track=%s segments n=%d min=%d mean=%d max=%d over_limit=%d\n\r",
+    track_name, segments.count, segments.min, segments.count == 0 ? 0 : segments.total / segments.count,
+    segments.max, over_limit);
+}
+
+void route_bench_entry_task() {
+  InitPathing();
+  InitNavigation();
+
+  Create(PRIORITY_NAMESERVER, nameserver);
+  Create(PRIORITY_CLOCK_SERVER, clock_server);
+  Create(PRIORITY_UART_TX_SETUP, uart_tx);
+  Create(PRIORITY_IDLE_TASK, idle_task);
+  // the reservoir sends packets of what it reserves, like on the track
+  Create(4, reservoir_task);
+  Create(PRIORITY_SWITCH_CONTROLLER, switch_controller);
+
+  bwprintf(COM2, "=== ROUTING ===\n\r");
+  route_bench_track("a", init_tracka);
+  route_bench_track("b", init_trackb);
+  bwprintf(COM2, "=== ROUTING DONE ===\n\r");
+  ExitKernel();
+}
@@ -0,0 +1,394 @@
+#include <bwio.h>
+#include <kernel.h>
+#include <jstring.h>
+#include <servers/nameserver.h>
+#include <idle_task.h>
+#include <trains/navigation.h>
+#include <servers/clock_server.h>
+#include <servers/uart_tx_server.h>
+#include <servers/uart_rx_server.h>
+#include <detective/sensor_detector_multiplexer.h>
+#include <interactive/commands.h>
+#include <train_command_server.h>
+#include <trains/switch_controller.h>
+#include <trains/executor.h>
+#include <trains/sensor_collector.h>
+#include <track/pathing.h>
+#include <trains/reservoir.h>
+#include <priorities.h>
+#include <trains/train_controller.h>
+#include <latency_probe.h>
+#include <trains/marklin_simulator.h>
+
+/**
+ * Runs train control against the track simulator without the terminal, and
+ * prints how well it did as a single line for tools/scenario_sweep:
+ *   SCENARIO_RESULT scenario=<name> trips=<n> failures=<n> ...
+ *
+ * Configured with environment variables (x86 only):
+ *   SCENARIO          random  navigates to random sensors (default)
+ *                     route   navigates through the nodes in route=, in turn
+ *   SCENARIO_DURATION seconds of track time to run for, default 120
+ *   SCENARIO_PARAMS   comma separated key=value, see scenario_param
+ *
+ * Run with LOCAL_TIME=virtual so the track time takes no longer than the
+ * code does to run, and runs are reproducible.
+ */
+
+#if defined(DEBUG_MODE)
+
+#include <stdlib.h>
+
+// A trip fails if the train hasn't stopped by then, long enough for a lap
+// of the track at a low speed
+#define SCENARIO_TRIP_TIMEOUT 30000
+// The train is considered stopped once it stood still this long, as it
+// stops for a moment to reverse
+#define SCENARIO_SETTLE_TICKS 300
+// A trip has no route if the train hasn't moved by then
+#define SCENARIO_START_TICKS 1000
+// Stopping further than this from the destination, in mm, is a failed trip
+// rather than an inaccurate stop
+#define SCENARIO_LOST_DISTANCE 1000
+#define SCENARIO_POLL_TICKS 5
+#define SCENARIO_ROUTE_MAX 32
+
+typedef struct {
+  int train;
+  int speed;
+  int start;
+  unsigned int seed;
+  bool verbose;
+  int route[SCENARIO_ROUTE_MAX];
+  int route_len;
+
+  // -1 to leave as is
+  int velocity;
+  int stop_factor;
+  int stop_offset;
+  int switch_cutoff;
+  int sim_velocity;
+  int sim_accel;
+  int sim_decel;
+
+  int sensor_miss;
+  int sensor_spurious;
+  int switch_failure;
+} scenario_t;
+
+typedef struct {
+  int trips;
+  int failures;
+  // trips the train had no route for, without reversing
+  int unroutable;
+  // trips where the train stopped far from the destination
+  int lost;
+  int ticks;
+  int trip_ticks;
+  int error_sum;
+  int abs_error_sum;
+  int max_abs_error;
+} scenario_result_t;
+
+static int parse_int(const char *value) {
+  return value[0] == '-' ? -ja2i((char *) value + 1) : ja2i((char *) value);
+}
+
+static void parse_route(scenario_t *scenario, char *value) {
+  char *name = value;
+  scenario->route_len = 0;
+  while (*name != '\0' && scenario->route_len < SCENARIO_ROUTE_MAX) {
+    char *end = name;
+    while (*end != '\0' && *end != '/') end++;
+    char separator = *end;
+    *end = '\0';
+    int node = Name2Node(name);
+    KASSERT(node != -1, "Scenario route has unknown node %s", name);
+    scenario->route[scenario->route_len++] = node;
+    if (separator == '\0') break;
+    name = end + 1;
+  }
+}
+
+/**
+ * Sets a scenario parameter, see apply_params for when they take effect
+ *   train, speed, start (node name), seed, verbose, route (node/node/...)
+ *   velocity        calibrated velocity of the train at speed, in mm/s
+ *   stop_factor     stopping_distance_factor
+ *   stop_offset     stop_distance_offset, this only pads reservations, so it
+ *                   doesn't change where trains stop
+ *   switch_cutoff   switch_time_cutoff
+ *   sim_velocity    actual velocity of the train at speed, in mm/s
+ *   sim_accel       actual acceleration to speed, in mm/s^2
+ *   sim_decel       actual deceleration to stopped, in mm/s^2
+ *   sensor_miss, sensor_spurious, switch_failure   faults, per 1000
+ */
+static void scenario_param(scenario_t *scenario, char *key, char *value) {
+  if (jstrcmp(key, "train")) {
+    scenario->train = parse_int(value);
+  } else if (jstrcmp(key, "speed")) {
+    scenario->speed = parse_int(value);
+  } else if (jstrcmp(key, "start")) {
+    scenario->start = Name2Node(value);
+    KASSERT(scenario->start != -1, "Scenario has unknown start node %s", value);
+  } else if (jstrcmp(key, "seed")) {
+    scenario->seed = parse_int(value);
+  } else if (jstrcmp(key, "verbose")) {
+    scenario->verbose = parse_int(value) != 0;
+  } else if (jstrcmp(key, "route")) {
+    parse_route(scenario, value);
+  } else if (jstrcmp(key, "velocity")) {
+    scenario->velocity = parse_int(value);
+  } else if (jstrcmp(key, "stop_factor")) {
+    scenario->stop_factor = parse_int(value);
+  } else if (jstrcmp(key, "stop_offset")) {
+    scenario->stop_offset = parse_int(value);
+  } else if (jstrcmp(key, "switch_cutoff")) {
+    scenario->switch_cutoff = parse_int(value);
+  } else if (jstrcmp(key, "sim_velocity")) {
+    scenario->sim_velocity = parse_int(value);
+  } else if (jstrcmp(key, "sim_accel")) {
+    scenario->sim_accel = parse_int(value);
+  } else if (jstrcmp(key, "sim_decel")) {
+    scenario->sim_decel = parse_int(value);
+  } else if (jstrcmp(key, "sensor_miss")) {
+    scenario->sensor_miss = parse_int(value);
+  } else if (jstrcmp(key, "sensor_spurious")) {
+    scenario->sensor_spurious = parse_int(value);
+  } else if (jstrcmp(key, "switch_failure")) {
+    scenario->switch_failure = parse_int(value);
+  } else {
+    KASSERT(false, "Unknown scenario parameter %s", key);
+  }
+}
+
+static void parse_params(scenario_t *scenario, char *params) {
+  char *key = params;
+  while (*key != '\0') {
+    char *end = key;
+    while (*end != '\0' && *end != ',') end++;
+    char separator = *end;
+    *end = '\0';
+    char *value = key;
+    while (*value != '\0' && *value != '=') value++;
+    KASSERT(*value == '=', "Scenario parameter %s has no value", key);
+    *value = '\0';
+    scenario_param(scenario, key, value + 1);
+    if (separator == '\0') break;
+    key = end + 1;
+  }
+}
+
+/**
+ * Applies the parameters which depend on others, once all are parsed. The
+ * simulated train defaults to the calibration InitNavigation starts with,
+ * and the calibration parameters are only applied after, so a sweep of them
+ * shows how far off they make navigation. By default navigation only errs
+ * by the rounding of the simulation
+ */
+static void apply_params(scenario_t *scenario) {
+  int train = scenario->train;
+  int speed = scenario->speed;
+
+  int velocity = Velocity(train, speed);
+  int stopping_distance = StoppingDistance(train, speed);
+  // v^2 = 2ad
+  int decel = velocity * velocity / (2 * stopping_distance);
+  if (scenario->sim_velocity != -1) velocity = scenario->sim_velocity;
+  if (scenario->sim_decel != -1) decel = scenario->sim_decel;
+  SimulatorSetSpeedProfile(train, speed, velocity, scenario->sim_accel != -1 ? scenario->sim_accel : decel);
+  SimulatorSetSpeedProfile(train, 0, 0, decel);
+  SimulatorSetFaults(scenario->sensor_miss, scenario->sensor_spurious, scenario->switch_failure, scenario->seed);
+
+  if (scenario->velocity != -1) set_velocity(train, speed, scenario->velocity);
+  if (scenario->stop_factor != -1) stopping_distance_factor = scenario->stop_factor;
+  if (scenario->stop_offset != -1) stop_distance_offset = scenario->stop_offset;
+  if (scenario->switch_cutoff != -1) switch_time_cutoff = scenario->switch_cutoff;
+}
+
+static int next_destination(scenario_t *scenario, int trip) {
+  if (scenario->route_len > 0) {
+    return scenario->route[trip % scenario->route_len];
+  }
+  int location = WhereAmI(scenario->train);
+  int dest;
+  do {
+    scenario->seed = scenario->seed * 1103515245 + 12345;
+    dest = (scenario->seed >> 16) % SIMULATOR_SENSORS;
+  } while (dest == location || dest == GetReverseNode(location));
+  return dest;
+}
+
+/**
+ * Waits for the train to go and then stop again
+ * @return ticks when it stopped
+ *         -1 => it didn't start moving, so there was no route
+ *         -2 => it didn't stop by the timeout
+ */
+static int wait_for_trip(int train, int start) {
+  bool moved = false;
+  int stopped_at = -1;
+  while (Time() < start + SCENARIO_TRIP_TIMEOUT) {
+    Delay(SCENARIO_POLL_TICKS);
+    if (SimulatorTrainVelocity(train) > 0) {
+      moved = true;
+      stopped_at = -1;
+    } else if (!moved && Time() - start >= SCENARIO_START_TICKS) {
+      return -1;
+    } else if (moved && stopped_at == -1) {
+      stopped_at = Time();
+    } else if (moved && Time() - stopped_at >= SCENARIO_SETTLE_TICKS) {
+      return stopped_at;
+    }
+  }
+  return -2;
+}
+
+static void send_train_command(int executor_tid, int type, int train, int speed) {
+  cmd_data_t msg;
+  msg.base.packet.type = INTERPRETED_COMMAND;
+  msg.base.type = type;
+  msg.train = train;
+  msg.speed = speed;
+  SendSN(executor_tid, msg);
+}
+
+static void run_scenario(scenario_t *scenario, int duration, scenario_result_t *result) {
+  int executor_tid = WhoIsEnsured(NS_EXECUTOR);
+  int train = scenario->train;
+  int start = Time();
+  int end = start + duration * 100;
+
+  cmd_data_t msg;
+  msg.base.packet.type = INTERPRETED_COMMAND;
+  msg.base.type = COMMAND_NAVIGATE;
+  msg.train = train;
+  msg.speed = scenario->speed;
+
+  for (int trip = 0; Time() < end; trip++) {
+    int trip_start = Time();
+    msg.dest_node = next_destination(scenario, trip);
+    SendSN(executor_tid, msg);
+    int stopped_at = wait_for_trip(train, trip_start);
+    if (stopped_at == -1) {
+      // Paths don't include reversing, so turn the train around like an
+      // operator would, and carry on from there
+      send_train_command(executor_tid, COMMAND_TRAIN_REVERSE, train, 0);
+      Delay(SCENARIO_SETTLE_TICKS);
+      result->unroutable++;
+      if (scenario->verbose) bwprintf(COM2, "trip %d to %s has no route, reversing\n\r", trip, track[msg.dest_node].name);
+      continue;
+    } else if (stopped_at == -2) {
+      // stop the train, so the next trip starts from a standstill
+      send_train_command(executor_tid, COMMAND_TRAIN_SPEED, train, 0);
+      while (SimulatorTrainVelocity(train) > 0) Delay(SCENARIO_POLL_TICKS);
+      result->failures++;
+      if (scenario->verbose) bwprintf(COM2, "trip %d to %s timed out\n\r", trip, track[msg.dest_node].name);
+      continue;
+    }
+
+    int error;
+    if (SimulatorTrainOffset(train, msg.dest_node, &error) != 0 || error < -SCENARIO_LOST_DISTANCE || error > SCENARIO_LOST_DISTANCE) {
+      result->lost++;
+      if (scenario->verbose) bwprintf(COM2, "trip %d to %s stopped elsewhere\n\r", trip, track[msg.dest_node].name);
+      continue;
+    }
+    int abs_error = error < 0 ? -error : error;
+    result->trips++;
+    result->trip_ticks += stopped_at - trip_start;
+    result->error_sum += error;
+    result->abs_error_sum += abs_error;
+    if (abs_error > result->max_abs_error) result->max_abs_error = abs_error;
+    if (scenario->verbose) bwprintf(COM2, "trip %d to %s took %d ticks, stopped %dmm past\n\r", trip, track[msg.dest_node].name, stopped_at - trip_start, error);
+  }
+  result->ticks = Time() - start;
+}
+
+void scenario_entry_task() {
+  InitPathing();
+  InitNavigation();
+  InitLatencyProbes();
+  InitTrainControllers();
+  InitMarklinSimulator();
+
+  const char *name = getenv("SCENARIO");
+  const char *duration_env = getenv("SCENARIO_DURATION");
+  const char *params = getenv("SCENARIO_PARAMS");
+  if (name == NULL) name = "random";
+  int duration = duration_env != NULL ? ja2i((char *) duration_env) : 120;
+
+  scenario_t scenario;
+  scenario.train = 70;
+  scenario.speed = 5;
+  scenario.start = Name2Node("A4");
+  scenario.seed = 1;
+  scenario.verbose = false;
+  scenario.route_len = 0;
+  scenario.velocity = -1;
+  scenario.stop_factor = -1;
+  scenario.stop_offset = -1;
+  scenario.switch_cutoff = -1;
+  scenario.sim_velocity = -1;
+  scenario.sim_accel = -1;
+  scenario.sim_decel = -1;
+  scenario.sensor_miss = 0;
+  scenario.sensor_spurious = 0;
+  scenario.switch_failure = 0;
+  if (params != NULL) {
+    char buffer[512];
+    jstrncpy(buffer, params, sizeof(buffer));
+    parse_params(&scenario, buffer);
+  }
+  apply_params(&scenario);
+  KASSERT(jstrcmp((char *) name, "random") || (jstrcmp((char *) name, "route") && scenario.route_len > 0), "Unknown scenario %s, or route without route=", name);
+
+  SimulatorPlaceTrain(scenario.train, scenario.start);
+  SetTrainLocation(scenario.train, scenario.start);
+
+  Create(PRIORITY_NAMESERVER, nameserver);
+  Create(PRIORITY_CLOCK_SERVER, clock_server);
+  // FIXME: priority
+  Create(0, uart_tx);
+  // FIXME: priority
+  Create(0, uart_rx);
+  Create(PRIORITY_IDLE_TASK, idle_task);
+
+  // Same servers as train_control_entry_task, without the terminal
+  // FIXME: priority
+  Create(4, reservoir_task);
+  // FIXME: priority
+  Create(4, sensor_detector_multiplexer_task);
+  // FIXME: priority
+  Create(3, executor_task);
+  Create(PRIORITY_TRAIN_COMMAND_SERVER, train_command_server);
+  Create(PRIORITY_SWITCH_CONTROLLER, switch_controller);
+  // FIXME: priority
+  Create(PRIORITY_SWITCH_CONTROLLER+1, sensor_attributer);
+  Create(PRIORITY_SWITCH_CONTROLLER+2, sensor_collector_task);
+
+  if (!scenario.verbose) SetLogMask(0);
+
+  scenario_result_t result;
+  result.trips = 0;
+  result.failures = 0;
+  result.unroutable = 0;
+  result.lost = 0;
+  result.trip_ticks = 0;
+  result.error_sum = 0;
+  result.abs_error_sum = 0;
+  result.max_abs_error = 0;
+  run_scenario(&scenario, duration, &result);
+
+  // totals, so the sweep can average across seeds
+  bwprintf(COM2, "SCENARIO_RESULT scenario=%s ticks=%d trips=%d failures=%d unroutable=%d lost=%d trip_ticks=%d error_sum=%d abs_error_sum=%d max_abs_error=%d\n\r",
+    name, result.ticks, result.trips, result.failures, result.unroutable, result.lost, result.trip_ticks, result.error_sum, result.abs_error_sum, result.max_abs_error);
+  ExitKernel();
+}
+
+#else
+
+void scenario_entry_task() {
+  KASSERT(false, "Scenarios need the track simulator, build with LOCAL=true");
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include <kernel.h>
+#include <bwio.h>
+#include <entries.h>
+#include <kern/context.h>
+#include <kern/budget.h>
+#include <kern/scheduler.h>
+
+/**
+ * Tids are reused once their task exits or is destroyed. Each case here
+ * gives an old task's tid to a new one, and checks the new task isn't
+ * mistaken for the old one, or checks the old task left nothing behind
+ */
+
+// Higher priority than the entry task, so created tasks run right away
+#define REUSE_TEST_PRIORITY 5
+
+static int reused_tid;
+static int child_tid;
+static int receiver_tid;
+
+static void blocked_task() {
+  int sender;
+  Receive(&sender, NULL, 0);
+}
+
+// Only the task which got reused_tid blocks, the rest exit straight away
+static void reusing_task() {
+  if (MyTid() != reused_tid) return;
+  blocked_task();
+}
+
+static int create_reusing(int tid) {
+  reused_tid = tid;
+  int created;
+  do {
+    created = Create(REUSE_TEST_PRIORITY, reusing_task);
+  } while (created != tid);
+  return created;
+}
+
+static void sending_task() {
+  Send(MyParentTid(), NULL, 0, NULL, 0);
+}
+
+static void sending_to_receiver_task() {
+  Send(receiver_tid, NULL, 0, NULL, 0);
+}
+
+// Spins once told to, until its budget group is throttled and it's parked.
+// Passes, as the local build only takes interrupts on kernel entry
+static void spinning_task() {
+  int sender;
+  Receive(&sender, NULL, 0);
+  ReplyN(sender);
+  while (true) Pass();
+}
+
+static bool is_ready_queued(int tid) {
+  for (int priority = 0; priority <= MAX_PRIORITY; priority++) {
+    for (task_descriptor_t *task = ready_queues[priority]; task != NULL; task = task->next_ready_task) {
+      if (task->tid == tid) return true;
+    }
+  }
+  return false;
+}
+
+static void exiting_parent_task() {
+  child_tid = Create(REUSE_TEST_PRIORITY, blocked_task);
+}
+
+static void test_destroy_keeps_old_children() {
+  int parent_tid = Create(REUSE_TEST_PRIORITY, exiting_parent_task);
+  int tid = create_reusing(parent_tid);
+  Destroy(tid);
+  bool ok = ctx->descriptors[child_tid].state != STATE_ZOMBIE;
+  bwprintf(COM2, "  destroying a reused tid spares the old task's children: %s\n\r", ok ? "ok" : "FAILED");
+}
+
+static void test_receive_skips_destroyed_sender() {
+  int destroyed_tid = Create(REUSE_TEST_PRIORITY, sending_task);
+  Destroy(destroyed_tid);
+  create_reusing(destroyed_tid);
+  int sender_tid = Create(REUSE_TEST_PRIORITY, sending_task);
+
+  int tid;
+  Receive(&tid, NULL, 0);
+  ReplyN(tid);
+  bool ok = tid == sender_tid;
+  bwprintf(COM2, "  receive skips a destroyed sender whose tid was reused: %s\n\r", ok ? "ok" : "FAILED");
+}
+
+static void test_destroy_leaves_reused_sender_blocked() {
+  // Lower priority than the entry task, so it doesn't get to Receive
+  receiver_tid = Create(REUSE_TEST_PRIORITY + 20, blocked_task);
+  int destroyed_tid = Create(REUSE_TEST_PRIORITY, sending_to_receiver_task);
+  Destroy(destroyed_tid);
+  int tid = create_reusing(destroyed_tid);
+
+  Destroy(receiver_tid);
+  bool ok = ctx->descriptors[tid].state == STATE_SEND_BLOCKED;
+  bwprintf(COM2, "  destroying a receiver leaves a reused sender's tid blocked: %s\n\r", ok ? "ok" : "FAILED");
+}
+
+static void test_destroy_unparks_throttled_task() {
+  int group = CreateBudgetGroup(1, 100);
+  int spinning_tid = Create(REUSE_TEST_PRIORITY, spinning_task);
+  JoinBudgetGroup(spinning_tid, group);
+  Send(spinning_tid, NULL, 0, NULL, 0);
+  // runs once the spinning task is throttled
+  Destroy(spinning_tid);
+  int tid = create_reusing(spinning_tid);
+
+  // releases the group's parked tasks
+  while (budget_groups[group].throttled) Pass();
+  bool ok = ctx->descriptors[tid].state == STATE_SEND_BLOCKED;
+  bwprintf(COM2, "  destroying a parked task keeps its reused tid off the ready queues: %s\n\r", ok ? "ok" : "FAILED");
+}
+
+static void test_destroy_dequeues_ready_task() {
+  // Lower priority than the entry task, so it's left on its ready queue
+  int ready_tid = Create(REUSE_TEST_PRIORITY + 20, blocked_task);
+  Destroy(ready_tid);
+  // otherwise the next task with its tid is queued twice
+  bool ok = !is_ready_queued(ready_tid);
+  bwprintf(COM2, "  destroying a ready task takes it off its ready queue: %s\n\r", ok ? "ok" : "FAILED");
+}
+
+void tid_reuse_test_task() {
+  bwprintf(COM2, "===Tid reuse test===\n\r");
+  test_destroy_keeps_old_children();
+  test_receive_skips_destroyed_sender();
+  test_destroy_leaves_reused_sender_blocked();
+  test_destroy_unparks_throttled_task();
+  test_destroy_dequeues_ready_task();
+  ExitKernel();
+}
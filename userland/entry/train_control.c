@@ -18,12 +18,22 @@
 #include <trains/reservoir.h>
 #include <priorities.h>
 #include <trains/train_controller.h>
+#include <latency_probe.h>
+#include <trains/marklin_simulator.h>
 
 void train_control_entry_task() {
   InitPathing();
   InitNavigation();
+  InitLatencyProbes();
   InitTrainControllers();
 
+  #if defined(DEBUG_MODE)
+  // Stand in for the track, with the trains where navigation expects them
+  InitMarklinSimulator();
+  SimulatorPlaceTrain(70, Name2Node("A4"));
+  SimulatorPlaceTrain(69, Name2Node("C9"));
+  #endif
+
   Create(PRIORITY_NAMESERVER, nameserver);
   Create(PRIORITY_CLOCK_SERVER, clock_server);
   // FIXME: priority
@@ -47,9 +57,15 @@ void train_control_entry_task() {
   Create(PRIORITY_SWITCH_CONTROLLER+1, sensor_attributer);
   Create(PRIORITY_SWITCH_CONTROLLER+2, sensor_collector_task);
 
+  // Terminal rendering and command handling may only use 20% of the CPU, so
+  // heavy output can't delay train control. Tasks inherit the budget group
+  // of their creator, so join it while creating them
+  int ui_budget_group = CreateBudgetGroup(20, 100);
+  JoinBudgetGroup(MyTid(), ui_budget_group);
   Create(PRIORITY_INTERACTIVE, interactive);
   // FIXME: priority
   Create(6, command_interpreter_task);
   // FIXME: priority
   Create(7, command_parser_task);
+  JoinBudgetGroup(MyTid(), -1);
 }
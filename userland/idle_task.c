@@ -1,4 +1,5 @@
 #include <basic.h>
+#include <kernel.h>
 #include <ts7200.h>
 #include <idle_task.h>
 #include <servers/nameserver.h>
@@ -7,6 +8,11 @@ void idle_task() {
   while (true) {
     // We track time in the kernel, and print it there also
     // so just loop!
+    #if defined(DEBUG_MODE)
+    // nothing preempts tasks on x86, so let the kernel run the devices
+    Pass();
+    #else
     asm __volatile__("");
+    #endif
   }
 }
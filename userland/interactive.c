@@ -18,6 +18,8 @@
 #include <trains/switch_controller.h>
 #include <jstring.h>
 #include <priorities.h>
+#include <server_stats.h>
+#include <latency_probe.h>
 #include <interactive/command_parser.h>
 #include <interactive/interactive.h>
 #include <track/track_node.h>
@@ -254,6 +256,7 @@ void TriggerSensor(int sensor_no, int sensor_time) {
 
   sensor_data_t req;
   req.packet.type = SENSOR_DATA;
+  probe_clear(&req.probe);
   req.timestamp = Time();
   req.sensor_no = sensor_no;
   // Send to attributer
@@ -328,6 +331,9 @@ void DrawInitialScreen() {
 
   MoveTerminalCursor(0, COMMAND_LOCATION);
   Putstr(COM2, "Commands");
+
+  MoveTerminalCursor(0, TOP_LOCATION);
+  Putstr(COM2, "Tid Task                  CPU%   Msg/s SendQ State");
   // Reset BG colour
   Putstr(COM2, RESET_ATTRIBUTES);
 
@@ -370,6 +376,90 @@ void DrawIdlePercent() {
   Logs(IDLE_LOGGING, buf);
 }
 
+// number of tasks shown in the top view
+#define TOP_TASKS 8
+// the time keeper ticks every 100ms, so the top view refreshes every second
+#define TOP_REFRESH_INTERVALS 10
+// most live tasks a snapshot can hold, tasks past this are not shown
+#define TOP_MAX_SNAPSHOT 128
+
+task_stats_t top_snapshot[TOP_MAX_SNAPSHOT];
+// execution time and messages of each tid, as of the previous refresh
+io_time_t top_last_execution_time[MAX_TASKS];
+unsigned int top_last_messages[MAX_TASKS];
+io_time_t last_time_top_displayed;
+int top_refresh_counter;
+
+static const char *top_state_name(task_state_t state) {
+  switch (state) {
+  case STATE_ACTIVE: return "Active";
+  case STATE_READY: return "Ready";
+  case STATE_SEND_BLOCKED: return "SendBl";
+  case STATE_RECEIVE_BLOCKED: return "RecvBl";
+  case STATE_REPLY_BLOCKED: return "ReplBl";
+  case STATE_EVENT_BLOCKED: return "EventBl";
+  default: return "?";
+  }
+}
+
+void DrawTopTasks() {
+  int count = GetStats(NULL, top_snapshot, TOP_MAX_SNAPSHOT);
+  io_time_t curr_time = io_get_time();
+  io_time_t time_total = curr_time - last_time_top_displayed;
+  last_time_top_displayed = curr_time;
+  int elapsed_ms = io_time_ms(time_total);
+  if (elapsed_ms == 0) elapsed_ms = 1;
+
+  // turn the totals into usage since the previous refresh. a tid which was
+  // recycled since then can have smaller totals, in which case count from 0
+  io_time_t cpu[TOP_MAX_SNAPSHOT];
+  unsigned int messages[TOP_MAX_SNAPSHOT];
+  int order[TOP_MAX_SNAPSHOT];
+  int i, j;
+  for (i = 0; i < count; i++) {
+    task_stats_t *task = &top_snapshot[i];
+    io_time_t last_execution_time = top_last_execution_time[task->tid];
+    unsigned int last_messages = top_last_messages[task->tid];
+    if (task->execution_time < last_execution_time) last_execution_time = 0;
+    if (task->messages_received < last_messages) last_messages = 0;
+    cpu[i] = task->execution_time - last_execution_time;
+    messages[i] = task->messages_received - last_messages;
+    top_last_execution_time[task->tid] = task->execution_time;
+    top_last_messages[task->tid] = task->messages_received;
+    order[i] = i;
+  }
+
+  // partial selection sort, only the top TOP_TASKS are needed
+  int shown = count < TOP_TASKS ? count : TOP_TASKS;
+  for (i = 0; i < shown; i++) {
+    int max = i;
+    for (j = i + 1; j < count; j++) {
+      if (cpu[order[j]] > cpu[order[max]]) max = j;
+    }
+    int tmp = order[i];
+    order[i] = order[max];
+    order[max] = tmp;
+  }
+
+  char name[22];
+  for (i = 0; i < TOP_TASKS; i++) {
+    MoveTerminalCursor(0, TOP_LOCATION + 1 + i);
+    Putstr(COM2, CLEAR_LINE);
+    if (i >= shown) continue;
+    int index = order[i];
+    task_stats_t *task = &top_snapshot[index];
+    // in ms, as ticks * 1000 overflows io_time_t on ARM after ~8s
+    int cpu_percent = (io_time_ms(cpu[index]) * 1000) / elapsed_ms;
+    jstrncpy(name, task->name, sizeof(name));
+    Putf(COM2, "%3d %-21s %3d.%01d%% %7d %5d %s",
+      task->tid, name,
+      cpu_percent / 10, cpu_percent % 10,
+      (int) ((messages[index] * 1000) / elapsed_ms),
+      task->send_queue_length,
+      top_state_name(task->state));
+  }
+}
+
 void RenderSwitchChange(int sw, int state) {
   int index = sw;
   if (index >= 153 && index <= 156) {
@@ -538,6 +628,12 @@ void interactive() {
   int sender;
   idle_execution_time = 0;
   last_time_idle_displayed = 0;
+  last_time_top_displayed = 0;
+  top_refresh_counter = 0;
+  for (int i = 0; i < MAX_TASKS; i++) {
+    top_last_execution_time[i] = 0;
+    top_last_messages[i] = 0;
+  }
 
   DrawInitialScreen();
   Putstr(COM2, SAVE_CURSOR);
@@ -600,6 +696,10 @@ void interactive() {
         int cur_time = Time();
         DrawTime(cur_time);
         DrawIdlePercent();
+        if (++top_refresh_counter >= TOP_REFRESH_INTERVALS) {
+          top_refresh_counter = 0;
+          DrawTopTasks();
+        }
 
         // if (is_pathing && path_update_counter >= 3) {
         //   path_update_counter = 0;
@@ -618,7 +718,7 @@ void interactive() {
           break;
         case COMMAND_TRAIN_SPEED:
           Putf(COM2, "Set train %d to speed %d", cmd_data->train, cmd_data->speed);
-          RecordLogf("Set train %d to speed %d\n\r", cmd_data->train, cmd_data->speed);
+          FlightRecord("Set train %d to speed %d", cmd_data->train, cmd_data->speed, 0);
           samples = 0;
           lastTrain = cmd_data->train;
           velocity_reading_delay_until = Time();
@@ -647,6 +747,17 @@ void interactive() {
           }
           break;
         case COMMAND_QUIT:
+          RecordLogf("Suppressed logs: uptime=%u idle=%u executor=%u info=%u other=%u\n\r",
+            log_suppressed[LOG_CATEGORY_UPTIME], log_suppressed[LOG_CATEGORY_IDLE],
+            log_suppressed[LOG_CATEGORY_EXECUTOR], log_suppressed[LOG_CATEGORY_INFO],
+            log_suppressed[LOG_CATEGORY_OTHER]);
+          RecordServerStats("reservoir", WhoIs(NS_RESERVOIR));
+          RecordServerStats("switch controller", WhoIs(NS_SWITCH_CONTROLLER));
+          RecordServerStats("clock server", WhoIs(NS_CLOCK_SERVER));
+          RecordServerStats("UART1 tx server", WhoIs(NS_UART1_TX_SERVER));
+          RecordServerStats("UART2 tx server", WhoIs(NS_UART2_TX_SERVER));
+          RecordServerStats("nameserver", WhoIs(NS_NAMESERVER));
+          RecordLatencyProbes();
           ExitKernel();
           break;
         case COMMAND_CLEAR_SENSOR_SAMPLES:
@@ -739,6 +850,11 @@ void interactive() {
         case COMMAND_MANUAL_SENSE:
           Putf(COM2, "Manually triggering sensor %s", track[cmd_data->dest_node].name);
           TriggerSensor(cmd_data->dest_node, Time());
+          break;
+        case COMMAND_SET_LOG_MASK:
+          SetLogMask(cmd_data->extra_arg);
+          Putf(COM2, "Log mask set to %x, %u suppressed so far", cmd_data->extra_arg, LogSuppressedTotal());
+          break;
         }
         MoveTerminalCursor(40, COMMAND_LOCATION + 2);
         Putstr(COM2, CLEAR_LINE_BEFORE);
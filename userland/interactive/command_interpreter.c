@@ -281,6 +281,17 @@ static void command_manual_sense(int interactive_tid, int executor_tid, parsed_c
   }
 }
 
+static void command_set_log_mask(int interactive_tid, int executor_tid, parsed_command_t *data) {
+  CMD_ASSERT_ARGC(data, 1);
+  CMD_ASSERT_IS_INT(data, 0);
+  cmd_data_t msg;
+  msg.base.packet.type = INTERPRETED_COMMAND;
+  msg.base.type = COMMAND_SET_LOG_MASK;
+  msg.extra_arg = GetInt(data, 0);
+  // NOTE: only sends to UI
+  SendSN(interactive_tid, msg);
+}
+
 #define DEF_CASE(cmd, cmd_func) case cmd: cmd_func(interactive_tid, executor_tid, data); break;
 
 void command_interpreter_task() {
@@ -339,6 +350,7 @@ void command_interpreter_task() {
     DEF_CASE(COMMAND_PATH, command_path);
     DEF_CASE(COMMAND_STOP_FROM, command_stop_from);
     DEF_CASE(COMMAND_MANUAL_SENSE, command_manual_sense);
+    DEF_CASE(COMMAND_SET_LOG_MASK, command_set_log_mask);
 
     case COMMAND_INVALID:
       jformatf(cmd.error, sizeof(cmd.error), "Invalid command: %s", data->cmd);
@@ -49,6 +49,8 @@ command_t get_command_type(char *command) {
   DEF_COMMAND("stopdist", COMMAND_SET_STOPPING_DISTANCE)
   // manually sets the stopdistance for a train speed
   DEF_COMMAND("stopdistn", COMMAND_SET_STOPPING_DISTANCEN)
+  // sets the runtime enabled log categories, a mask of category bits
+  DEF_COMMAND("log", COMMAND_SET_LOG_MASK)
   // moves the train to a node and sends the stop command on arrival
   // (only works for sensor nodes)
   DEF_COMMAND("stopfrom", COMMAND_STOP_FROM) {
@@ -44,6 +44,8 @@ typedef enum {
   COMMAND_PATH,
 
   COMMAND_MANUAL_SENSE,
+
+  COMMAND_SET_LOG_MASK,
 } command_t;
 
 typedef struct {
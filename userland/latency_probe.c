@@ -0,0 +1,101 @@
+#include <basic.h>
+#include <kernel.h>
+#include <latency_probe.h>
+
+// Row 0 is the whole pipeline, row i is from the previous stamped stage to
+// stage i. Probes are added by whichever task ends them, like RecordLog, so
+// a preempted add can at worst lose a sample
+static unsigned int probe_samples[PROBE_NUM_PIPELINES][PROBE_MAX_STAGES][PROBE_SAMPLES];
+static unsigned int probe_counts[PROBE_NUM_PIPELINES][PROBE_MAX_STAGES];
+
+static const char *pipeline_names[PROBE_NUM_PIPELINES] = {
+  "sensor",
+  "command",
+};
+
+static const char *stage_names[PROBE_NUM_PIPELINES][PROBE_MAX_STAGES] = {
+  { "read", "parsed", "attributed", "notified", "alerted", "reacted" },
+  { "requested", "handled", "written", "queued", "sent", NULL },
+};
+
+void InitLatencyProbes() {
+  for (int p = 0; p < PROBE_NUM_PIPELINES; p++) {
+    for (int s = 0; s < PROBE_MAX_STAGES; s++) {
+      probe_counts[p][s] = 0;
+    }
+  }
+}
+
+void probe_begin(latency_probe_t *probe, int pipeline) {
+  probe->pipeline = pipeline;
+  probe->stamped = 0;
+  probe_stamp(probe, 0);
+}
+
+void probe_clear(latency_probe_t *probe) {
+  probe->pipeline = PROBE_NONE;
+  probe->stamped = 0;
+}
+
+void probe_stamp(latency_probe_t *probe, int stage) {
+  if (probe->pipeline == PROBE_NONE) return;
+  KASSERT(0 <= stage && stage < PROBE_MAX_STAGES, "Invalid probe stage=%d", stage);
+  probe->stamps[stage] = io_get_time();
+  probe->stamped |= 1 << stage;
+}
+
+static void probe_add(int pipeline, int row, io_time_t duration) {
+  unsigned int i = probe_counts[pipeline][row]++ % PROBE_SAMPLES;
+  probe_samples[pipeline][row][i] = io_time_us(duration);
+}
+
+void probe_end(latency_probe_t *probe, int stage) {
+  if (probe->pipeline == PROBE_NONE) return;
+  probe_stamp(probe, stage);
+
+  int previous = -1;
+  for (int s = 0; s <= stage; s++) {
+    if (!(probe->stamped & (1 << s))) continue;
+    if (previous != -1) {
+      probe_add(probe->pipeline, s, probe->stamps[s] - probe->stamps[previous]);
+    }
+    previous = s;
+  }
+  if (probe->stamped & 1) {
+    probe_add(probe->pipeline, 0, probe->stamps[stage] - probe->stamps[0]);
+  }
+
+  probe_clear(probe);
+}
+
+static unsigned int percentile(unsigned int *sorted, int n, int p) {
+  return sorted[(p * (n - 1)) / 100];
+}
+
+void RecordLatencyProbes() {
+  unsigned int sorted[PROBE_SAMPLES];
+  for (int p = 0; p < PROBE_NUM_PIPELINES; p++) {
+    if (probe_counts[p][0] == 0) continue;
+    RecordLogf("Latency %s pipeline (us, last %d samples)\n\r", pipeline_names[p], PROBE_SAMPLES);
+    RecordLogf("  %-12s %8s %8s %8s %8s %8s\n\r", "stage", "count", "p50", "p90", "p99", "max");
+    for (int s = 0; s < PROBE_MAX_STAGES; s++) {
+      unsigned int count = probe_counts[p][s];
+      if (count == 0) continue;
+      int n = count < PROBE_SAMPLES ? count : PROBE_SAMPLES;
+
+      // insertion sort, there are few samples and this only runs on exit
+      for (int i = 0; i < n; i++) {
+        unsigned int value = probe_samples[p][s][i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+          sorted[j] = sorted[j - 1];
+          j--;
+        }
+        sorted[j] = value;
+      }
+
+      RecordLogf("  %-12s %8u %8u %8u %8u %8u\n\r", s == 0 ? "total" : stage_names[p][s], count,
+        percentile(sorted, n, 50), percentile(sorted, n, 90), percentile(sorted, n, 99), sorted[n - 1]);
+    }
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+/**
+ * End-to-end latency probes
+ *
+ * A latency_probe_t travels inside the messages of a pipeline, and every
+ * stage stamps the time it handled the message. The last stage ends the
+ * probe, which adds the time between each pair of stages to a global
+ * aggregator. RecordLatencyProbes writes percentiles for every stage into
+ * the logs printed on exit.
+ *
+ * Sensor pipeline
+ *   read        sensor bytes are in the UART buffer (polled every tick)
+ *   parsed      the collector sends a triggered sensor to the attributer
+ *   attributed  the attributer hands the sensor to a sensor_notifier
+ *   notified    the notifier runs, and has the attributed train
+ *   alerted     AlertTrainController sends to the train controller
+ *   reacted     the train controller finished handling the sensor
+ *
+ * Command pipeline, for train speeds and switches
+ *   requested   TellTrainController or SetSwitch was called
+ *   handled     the train or switch controller received the command
+ *   written     PutcsProbed was called with the bytes for COM1
+ *   queued      the UART tx server accepted the bytes
+ *   sent        the UART took the last byte
+ */
+
+#include <io.h>
+
+enum {
+  PROBE_PIPELINE_SENSOR,
+  PROBE_PIPELINE_COMMAND,
+
+  // Must be last
+  PROBE_NUM_PIPELINES,
+};
+
+// Marks a probe that isn't being measured, or has already ended
+#define PROBE_NONE -1
+
+enum {
+  PROBE_SENSOR_READ,
+  PROBE_SENSOR_PARSED,
+  PROBE_SENSOR_ATTRIBUTED,
+  PROBE_SENSOR_NOTIFIED,
+  PROBE_SENSOR_ALERTED,
+  PROBE_SENSOR_REACTED,
+};
+
+enum {
+  PROBE_COMMAND_REQUESTED,
+  PROBE_COMMAND_HANDLED,
+  PROBE_COMMAND_WRITTEN,
+  PROBE_COMMAND_QUEUED,
+  PROBE_COMMAND_SENT,
+};
+
+// Most stages of any pipeline
+#define PROBE_MAX_STAGES 6
+
+// Samples kept per stage for percentiles, older ones are overwritten
+#define PROBE_SAMPLES 128
+
+typedef struct {
+  // PROBE_PIPELINE_*, or PROBE_NONE
+  int pipeline;
+  // time each stage was reached, only valid for stamped stages
+  io_time_t stamps[PROBE_MAX_STAGES];
+  // bit for every stage stamped, a message may skip a stage
+  unsigned int stamped;
+} latency_probe_t;
+
+/**
+ * Resets the aggregator
+ */
+void InitLatencyProbes();
+
+/**
+ * Starts measuring, stamping the first stage of the pipeline
+ * @param probe    to start
+ * @param pipeline PROBE_PIPELINE_*
+ */
+void probe_begin(latency_probe_t *probe, int pipeline);
+
+/**
+ * Marks a probe as not measured, so stamping it does nothing. Messages
+ * which don't come from the start of a pipeline should clear their probe
+ */
+void probe_clear(latency_probe_t *probe);
+
+/**
+ * Stamps a stage of the probes pipeline, does nothing if the probe isn't
+ * being measured
+ * @param probe to stamp
+ * @param stage PROBE_SENSOR_* or PROBE_COMMAND_*
+ */
+void probe_stamp(latency_probe_t *probe, int stage);
+
+/**
+ * Stamps the last stage and adds the probe to the aggregator. The probe is
+ * then cleared, so it's only counted once
+ * @param probe to end
+ * @param stage last stage reached
+ */
+void probe_end(latency_probe_t *probe, int stage);
+
+/**
+ * Writes p50/p90/p99/max of every stage, and of the whole pipeline, into
+ * the recorded logs (RecordLog), which are printed on exit
+ */
+void RecordLatencyProbes();
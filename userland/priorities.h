@@ -24,6 +24,9 @@
 #define PRIORITY_CLOCK_SERVER 2
   #define PRIORITY_CLOCK_NOTIFIER 1
 
+// Starts the UART tx servers and warehouses, then exits
+#define PRIORITY_UART_TX_SETUP 2
+
 #define PRIORITY_UART1_TX_SERVER 2
   #define PRIORITY_UART1_TX_NOTIFIER 1
 
@@ -0,0 +1,80 @@
+#include <basic.h>
+#include <kernel.h>
+#include <jstring.h>
+#include <server_stats.h>
+
+void server_stats_init(server_stats_t *stats) {
+  for (int i = 0; i < SERVER_STATS_MAX_TYPES; i++) {
+    stats->types[i].type = SERVER_STATS_UNUSED_TYPE;
+    histogram_init(&stats->types[i].queue_wait);
+    histogram_init(&stats->types[i].service);
+  }
+  stats->current = NULL;
+  stats->current_start = 0;
+}
+
+void server_stats_start(server_stats_t *stats, int type) {
+  stats->current_start = io_get_time();
+
+  // servers have a handful of request types, so a scan is cheapest
+  server_request_stats_t *entry = &stats->types[SERVER_STATS_MAX_TYPES - 1];
+  for (int i = 0; i < SERVER_STATS_MAX_TYPES; i++) {
+    if (stats->types[i].type == type) {
+      entry = &stats->types[i];
+      break;
+    }
+    if (stats->types[i].type == SERVER_STATS_UNUSED_TYPE) {
+      stats->types[i].type = type;
+      entry = &stats->types[i];
+      break;
+    }
+  }
+
+  stats->current = entry;
+  histogram_add(&entry->queue_wait, io_time_us(LastReceiveQueueWait()));
+}
+
+void server_stats_end(server_stats_t *stats) {
+  if (stats->current == NULL) return;
+  histogram_add(&stats->current->service, io_time_difference_us(io_get_time(), stats->current_start));
+  stats->current = NULL;
+}
+
+bool server_stats_handle_query(server_stats_t *stats, int requester, int type) {
+  if (type != SERVER_STATS_QUERY) return false;
+  Reply(requester, stats, sizeof(server_stats_t));
+  return true;
+}
+
+int QueryServerStats(int tid, server_stats_t *stats) {
+  int query = SERVER_STATS_QUERY;
+  return Send(tid, &query, sizeof(query), stats, sizeof(server_stats_t));
+}
+
+static void record_timing(const char *label, histogram_t *timing) {
+  if (timing->count == 0) return;
+  RecordLogf("    %s min=%uus avg=%uus p99=%uus max=%uus\n\r      log2 us:", label,
+    timing->min, timing->total / timing->count, histogram_percentile(timing, 990), timing->max);
+  // up to the longest, rather than every bucket to 2^32us
+  int last = HISTOGRAM_BUCKETS - 1;
+  while (last > 0 && timing->buckets[last] == 0) last--;
+  for (int i = 0; i <= last; i++) {
+    RecordLogf(" %u", timing->buckets[i]);
+  }
+  RecordLog("\n\r");
+}
+
+void RecordServerStats(const char *name, int tid) {
+  if (tid < 0) return;
+  server_stats_t stats;
+  if (QueryServerStats(tid, &stats) < 0) return;
+
+  RecordLogf("Server %s (tid=%d)\n\r", name, tid);
+  for (int i = 0; i < SERVER_STATS_MAX_TYPES; i++) {
+    server_request_stats_t *entry = &stats.types[i];
+    if (entry->type == SERVER_STATS_UNUSED_TYPE) break;
+    RecordLogf("  type=%d count=%u\n\r", entry->type, entry->service.count);
+    record_timing("queue wait", &entry->queue_wait);
+    record_timing("service   ", &entry->service);
+  }
+}
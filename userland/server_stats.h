@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * Request instrumentation for servers
+ *
+ * A server keeps a server_stats_t, and brackets the handling of every
+ * request with server_stats_start and server_stats_end. For each request
+ * type this records the count, the time the request waited in the servers
+ * send queue, and the service time from Receive until the request has been
+ * handled. For requests which are replied to later, such as Delay, the
+ * service time only covers handling the request and not the deferred Reply.
+ *
+ * Every server request starts with an int type, so any instrumented server
+ * answers a SERVER_STATS_QUERY request with its stats, see QueryServerStats.
+ */
+
+#include <stdbool.h>
+#include <histogram.h>
+#include <io.h>
+
+// Request types tracked per server, any more are counted in the last one
+#define SERVER_STATS_MAX_TYPES 8
+
+// Request type of a stats query, negative so no server uses it already
+#define SERVER_STATS_QUERY -77
+
+// Marks a slot in server_stats_t.types which isn't used yet
+#define SERVER_STATS_UNUSED_TYPE -1
+
+typedef struct {
+  // the servers request type, or SERVER_STATS_UNUSED_TYPE
+  int type;
+  // in us
+  histogram_t queue_wait;
+  histogram_t service;
+} server_request_stats_t;
+
+typedef struct {
+  server_request_stats_t types[SERVER_STATS_MAX_TYPES];
+  // the request being handled, between server_stats_start and _end
+  server_request_stats_t *current;
+  io_time_t current_start;
+} server_stats_t;
+
+void server_stats_init(server_stats_t *stats);
+
+/**
+ * Records a request as received, call right after Receive
+ * @param stats of the server
+ * @param type  of the request
+ */
+void server_stats_start(server_stats_t *stats, int type);
+
+/**
+ * Records the request from server_stats_start as handled
+ * @param stats of the server
+ */
+void server_stats_end(server_stats_t *stats);
+
+/**
+ * Replies with the stats if the request is a SERVER_STATS_QUERY, so servers
+ * can skip it. The query itself isn't recorded
+ * @param  stats     of the server
+ * @param  requester of the request
+ * @param  type      of the request
+ * @return           true if the request was a query, and was replied to
+ */
+bool server_stats_handle_query(server_stats_t *stats, int requester, int type);
+
+/**
+ * Asks an instrumented server for its stats
+ * @param  tid   of the server
+ * @param  stats to copy to (OUTPUT)
+ * @return       bytes copied, or < 0 on error
+ */
+int QueryServerStats(int tid, server_stats_t *stats);
+
+/**
+ * Queries a server and writes its stats to the recorded logs (RecordLog),
+ * which are printed on exit
+ * @param name of the server
+ * @param tid  of the server, nothing is written if it's < 0
+ */
+void RecordServerStats(const char *name, int tid);
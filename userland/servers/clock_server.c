@@ -5,9 +5,13 @@
 #include <servers/nameserver.h>
 #include <heap.h>
 #include <priorities.h>
+#include <server_stats.h>
 
 static int clock_server_tid = -1;
 
+// Maximum amount of delayed tasks unblocked with a single ReplyMany
+#define UNDELAY_BATCH_SIZE 32
+
 enum {
   NOTIFIER,
   TIME_REQUEST,
@@ -47,6 +51,11 @@ void clock_server() {
   unsigned long int ticks = 0;
 
   clock_request_t request;
+  server_stats_t stats;
+  server_stats_init(&stats);
+
+  int undelay_tids[UNDELAY_BATCH_SIZE];
+  int num_undelay;
 
   // NOTE: MAX_TASKS + 1 because our heap is dumb, and needs 1 more...
   heapnode_t queue_nodes[MAX_TASKS + 1];
@@ -59,6 +68,10 @@ void clock_server() {
 
   while (true) {
     Receive(&requester, &request, sizeof(clock_request_t));
+    if (server_stats_handle_query(&stats, requester, request.type)) {
+      continue;
+    }
+    server_stats_start(&stats, request.type);
 
     switch (request.type) {
     case NOTIFIER:
@@ -88,13 +101,22 @@ void clock_server() {
     log_clock_server("clock_server: heap size=%d top=%d", tid, heap_size(&delay_queue), heap_peek_priority(&delay_queue));
 
     // Reply to suspended tasks that have timed out
+    num_undelay = 0;
     while (heap_size(&delay_queue) > 0 && heap_peek_priority(&delay_queue) <= ticks) {
       int tid_of_delay_done = (int) heap_pop(&delay_queue);
       log_clock_server("clock_server: undelay tid=%d", tid, tid_of_delay_done);
-      ReplyN(tid_of_delay_done);
+      undelay_tids[num_undelay++] = tid_of_delay_done;
+      if (num_undelay == UNDELAY_BATCH_SIZE) {
+        ReplyMany(undelay_tids, num_undelay, NULL, 0);
+        num_undelay = 0;
+      }
+    }
+    if (num_undelay > 0) {
+      ReplyMany(undelay_tids, num_undelay, NULL, 0);
     }
 
     log_clock_server("clock_server: time=%d", tid, ticks);
+    server_stats_end(&stats);
   }
 }
 
@@ -1,6 +1,7 @@
 #include <basic.h>
 #include <kernel.h>
 #include <servers/nameserver.h>
+#include <server_stats.h>
 
 static int nameserver_tid = -1;
 
@@ -15,6 +16,10 @@ void nameserver() {
   for (i = 0; i < NUM_TASK_NAMES; i++) {
     mapping[i] = -1;
   }
+  mapping[NS_NAMESERVER] = tid;
+
+  server_stats_t stats;
+  server_stats_init(&stats);
 
   // Always serve requests
   while (true) {
@@ -27,6 +32,10 @@ void nameserver() {
       // Receive failed, continue ?
       // FIXME: handle status
     }
+    if (server_stats_handle_query(&stats, source_tid, req.call_type)) {
+      continue;
+    }
+    server_stats_start(&stats, req.call_type);
 
     switch (req.call_type) {
     case REGISTER_CALL:
@@ -53,6 +62,7 @@ void nameserver() {
     default:
       KASSERT(false, "Nameserver received unknown req.call_type: got call_type=%d", req.call_type);
     }
+    server_stats_end(&stats);
   }
 }
 
@@ -25,6 +25,9 @@ enum task_name_t {
   NS_COMMAND_PARSER,
   NS_COMMAND_INTERPRETER,
   NS_INTERACTIVE,
+  NS_RESERVOIR,
+  // registered by the nameserver itself
+  NS_NAMESERVER,
 
   // NOTE: leave this at the end, OR ELSE!
   NUM_TASK_NAMES,
@@ -42,13 +42,11 @@ void uart_rx_notifier() {
     log_uart_server("uart_rx_notifer channel=%d", channel);
     switch(channel) {
       case COM1:
-        AwaitEvent(EVENT_UART1_RX);
-        req.ch = VMEM(UART1_BASE + UART_DATA_OFFSET);
+        req.ch = AwaitEvent(EVENT_UART1_RX);
         log_uart_server("uart_rx_notifer COM1 getc=%c", req.ch);
         break;
       case COM2:
-        AwaitEvent(EVENT_UART2_RX);
-        req.ch = VMEM(UART2_BASE + UART_DATA_OFFSET);
+        req.ch = AwaitEvent(EVENT_UART2_RX);
         log_uart_server("uart_rx_notifer COM2 getc=%c", req.ch);
         break;
     }
@@ -10,6 +10,7 @@
 #include <jstring.h>
 #include <courier.h>
 #include <warehouse.h>
+#include <server_stats.h>
 // Pretty terrible, using track graph for some local test output
 #include <track/pathing.h>
 
@@ -24,6 +25,48 @@ static int uart2_tx_server_tid = -1;
 
 static int logging_warehouse_tid = -1;
 
+volatile unsigned int log_enabled_mask = LOG_ALL_CATEGORIES;
+volatile unsigned int log_suppressed[LOG_NUM_CATEGORIES];
+
+/**
+ * Command probes waiting for their last byte to leave COM1. The tx server
+ * adds a probe with the count of bytes queued up to its last byte, and the
+ * notifier ends it once that many bytes were sent. The server only moves
+ * the tail and the notifier only moves the head, so neither needs a lock
+ */
+#define UART1_PENDING_PROBES 16
+
+typedef struct {
+  unsigned int last_byte;
+  latency_probe_t probe;
+} uart_pending_probe_t;
+
+static uart_pending_probe_t uart1_pending_probes[UART1_PENDING_PROBES];
+static volatile unsigned int uart1_pending_head = 0;
+static volatile unsigned int uart1_pending_tail = 0;
+static unsigned int uart1_bytes_queued = 0;
+static unsigned int uart1_bytes_sent = 0;
+
+static void uart1_queue_probe(latency_probe_t *probe) {
+  probe_stamp(probe, PROBE_COMMAND_QUEUED);
+  // if too many commands are in flight the probe is dropped
+  if (uart1_pending_tail - uart1_pending_head == UART1_PENDING_PROBES) return;
+  uart_pending_probe_t *pending = &uart1_pending_probes[uart1_pending_tail % UART1_PENDING_PROBES];
+  pending->last_byte = uart1_bytes_queued;
+  pending->probe = *probe;
+  uart1_pending_tail++;
+}
+
+static void uart1_byte_sent() {
+  uart1_bytes_sent++;
+  while (uart1_pending_head != uart1_pending_tail) {
+    uart_pending_probe_t *pending = &uart1_pending_probes[uart1_pending_head % UART1_PENDING_PROBES];
+    if ((int) (uart1_bytes_sent - pending->last_byte) < 0) break;
+    probe_end(&pending->probe, PROBE_COMMAND_SENT);
+    uart1_pending_head++;
+  }
+}
+
 void uart_tx_notifier() {
   int tid = MyTid();
 
@@ -48,6 +91,7 @@ void uart_tx_notifier() {
       case COM1:
         for (int i = 0; i < packet->len; i++) {
           AwaitEventPut(EVENT_UART1_TX, packet_data[i]);
+          uart1_byte_sent();
           log_uart_server("uart_notifer COM1 putc=%c", packet_data[i]);
         }
         break;
@@ -95,6 +139,8 @@ typedef struct {
   int channel;
   const char *ch;
   int len;
+  // command probe of a PUT_REQUEST to COM1, or NULL
+  latency_probe_t *probe;
 } uart_request_t;
 
 void uart_tx_server() {
@@ -103,13 +149,15 @@ void uart_tx_server() {
   char c;
 
   uart_request_t request;
+  server_stats_t stats;
+  server_stats_init(&stats);
 
-
-  char request_buffer[512] __attribute__ ((aligned (4)));
-  uart_packet_t * packet = (uart_packet_t *) request_buffer;
-  char * packet_data = request_buffer + sizeof(uart_packet_t);
-
-  packet->type = 1;
+  // packets to the courier are sent as the header and slices of outputQueue
+  uart_packet_t packet;
+  packet.type = 1;
+  iovec_t packet_iov[3];
+  packet_iov[0].base = &packet;
+  packet_iov[0].len = sizeof(uart_packet_t);
 
   ReceiveS(&requester, request);
   int channel = request.channel;
@@ -141,7 +189,10 @@ void uart_tx_server() {
 
     if (requester == courier_tid) {
       ready = true;
+    } else if (server_stats_handle_query(&stats, requester, request.type)) {
+      continue;
     } else {
+      server_stats_start(&stats, request.type);
       switch ( request.type ) {
       case PUT_REQUEST:
         while (true) {
@@ -153,10 +204,14 @@ void uart_tx_server() {
             request.len--;
           }
           request.ch++;
+          if (channel == COM1) {
+            uart1_bytes_queued++;
+          }
           if (ready && outputQueueLength == 0) {
-            packet->len = 1;
-            packet_data[0] = c;
-            Reply(courier_tid, request_buffer, sizeof(uart_packet_t) + packet->len);
+            packet.len = 1;
+            packet_iov[1].base = &c;
+            packet_iov[1].len = 1;
+            ReplyV(courier_tid, packet_iov, 2);
             ready = false;
           } else {
             KASSERT(outputQueueLength < OUTPUT_QUEUE_MAX, "UART output server queue has reached its limits for channel %d!", channel);
@@ -165,6 +220,9 @@ void uart_tx_server() {
             outputQueueLength += 1;
           }
         }
+        if (request.probe != NULL) {
+          uart1_queue_probe(request.probe);
+        }
         ReplyN(requester);
         break;
       case GET_QUEUE_REQUEST:
@@ -174,20 +232,26 @@ void uart_tx_server() {
         KASSERT(false, "uart_server received unknown request type=%d", request.type);
         break;
       }
+      server_stats_end(&stats);
     }
 
     if (ready && outputQueueLength > 0) {
-      packet->len = outputQueueLength;
-      if (packet->len > RESPONSE_BUFFER_SIZE) {
-        packet->len = RESPONSE_BUFFER_SIZE;
+      packet.len = outputQueueLength;
+      if (packet.len > RESPONSE_BUFFER_SIZE) {
+        packet.len = RESPONSE_BUFFER_SIZE;
       }
-      for (int i = 0; i < packet->len; i++) {
-        int index = (outputStart+i) % OUTPUT_QUEUE_MAX;
-        packet_data[i] = outputQueue[index];
+      // the queued data may wrap around the end of outputQueue
+      int first_len = OUTPUT_QUEUE_MAX - outputStart;
+      if (first_len > packet.len) {
+        first_len = packet.len;
       }
-      outputStart = (outputStart+packet->len) % OUTPUT_QUEUE_MAX;
-      outputQueueLength -= packet->len;
-      Reply(courier_tid, request_buffer, sizeof(uart_packet_t) + packet->len);
+      packet_iov[1].base = &outputQueue[outputStart];
+      packet_iov[1].len = first_len;
+      packet_iov[2].base = &outputQueue[0];
+      packet_iov[2].len = packet.len - first_len;
+      outputStart = (outputStart+packet.len) % OUTPUT_QUEUE_MAX;
+      outputQueueLength -= packet.len;
+      ReplyV(courier_tid, packet_iov, 3);
       ready = false;
     }
   }
@@ -199,6 +263,11 @@ void uart_tx_server() {
 void uart_tx() {
   uart_request_t request;
 
+  log_enabled_mask = LOG_ALL_CATEGORIES;
+  for (int i = 0; i < LOG_NUM_CATEGORIES; i++) {
+    log_suppressed[i] = 0;
+  }
+
   uart1_tx_notifier_tid = createNotifier(COM1, "UART1 TX notifier");
   uart2_tx_notifier_tid = createNotifier(COM2, "UART2 TX notifier");
 
@@ -236,7 +305,12 @@ void uart_tx() {
 }
 
 int Putcs( int channel, const char* c, int len ) {
+  return PutcsProbed(channel, c, len, NULL);
+}
+
+int PutcsProbed(int channel, const char *c, int len, latency_probe_t *probe) {
   KASSERT(channel == COM1 || channel == COM2, "Invalid channel provided: got channel=%d", channel);
+  KASSERT(probe == NULL || channel == COM1, "Only COM1 commands can be probed: got channel=%d", channel);
   log_task("Putc c=%c", active_task->tid, c);
   int server_tid = ((channel == COM1) ? uart1_tx_server_tid : uart2_tx_server_tid);
   if (server_tid == -1) {
@@ -249,6 +323,10 @@ int Putcs( int channel, const char* c, int len ) {
   req.channel = channel;
   req.ch = c;
   req.len = len;
+  req.probe = probe;
+  if (probe != NULL) {
+    probe_stamp(probe, PROBE_COMMAND_WRITTEN);
+  }
   SendSN(server_tid, req);
   return 0;
 }
@@ -266,6 +344,7 @@ int Putc( int channel, const char c ) {
   req.channel = channel;
   req.ch = &c;
   req.len = 1;
+  req.probe = NULL;
   SendSN(server_tid, req);
   return 0;
 }
@@ -284,6 +363,7 @@ int Putstr(int channel, const char *str ) {
   req.channel = channel;
   req.ch = str;
   req.len = -1;
+  req.probe = NULL;
   SendSN(server_tid, req);
   str++;
   return 0;
@@ -324,6 +404,46 @@ int PutPacket(uart_packet_t *packet) {
   return 0;
 }
 
+int PutPacketV(int type, const iovec_t *data, int datacnt) {
+  int len = 0;
+  for (int i = 0; i < datacnt; i++) {
+    len += data[i].len;
+  }
+
+  #if defined(DEBUG_MODE)
+  // Assemble the packet, to re-use the local output of PutPacket
+  char message_buffer[sizeof(uart_packet_t) + len] __attribute__ ((aligned (4)));
+  uart_packet_t *debug_packet = (uart_packet_t *) message_buffer;
+  debug_packet->type = type;
+  debug_packet->len = len;
+  char *packet_data = message_buffer + sizeof(uart_packet_t);
+  for (int i = 0; i < datacnt; i++) {
+    jmemcpy(packet_data, data[i].base, data[i].len);
+    packet_data += data[i].len;
+  }
+  return PutPacket(debug_packet);
+  #endif
+  log_task("PutPacketV len=%d type=%d", active_task->tid, len, type);
+  int server_tid = uart2_tx_warehouse_tid;
+  if (server_tid == -1) {
+    KASSERT(false, "UART tx server not initialized");
+    return -1;
+  }
+  KASSERT(len < 2048, "Packet length was a bit large. Ensure it's okay, len=%d", len);
+
+  uart_packet_t packet;
+  packet.type = type;
+  packet.len = len;
+  iovec_t iov[datacnt + 1];
+  iov[0].base = &packet;
+  iov[0].len = sizeof(uart_packet_t);
+  for (int i = 0; i < datacnt; i++) {
+    iov[i + 1] = data[i];
+  }
+  SendV(server_tid, iov, datacnt + 1, NULL, 0);
+  return 0;
+}
+
 int Logp(uart_packet_t *packet) {
   log_task("Logp str=%d", active_task->tid, packet.type);
   if (logging_warehouse_tid == -1) {
@@ -336,17 +456,140 @@ int Logp(uart_packet_t *packet) {
   return 0;
 }
 
-int Logf(int type, char *fmt, ...) {
+void SetLogMask(unsigned int mask) {
+  log_enabled_mask = mask;
+}
+
+unsigned int LogSuppressedTotal() {
+  unsigned int total = 0;
+  for (int i = 0; i < LOG_NUM_CATEGORIES; i++) {
+    total += log_suppressed[i];
+  }
+  return total;
+}
+
+int _Logf(int type, char *fmt, ...) {
   char buf[512];
   va_list va;
   va_start(va,fmt);
   jformat(buf, 512, fmt, va);
   va_end(va);
-  return Logs(type, buf);
+  return _Logs(type, buf);
+}
+
+// 32-bit FNV-1a, must match tools/log_decode
+static unsigned int log_format_hash(const char *fmt) {
+  unsigned int hash = 2166136261u;
+  while (*fmt) {
+    hash ^= (unsigned char) *fmt++;
+    hash *= 16777619u;
+  }
+  // 0 marks a call site that hasn't hashed its format yet
+  return hash == 0 ? 1 : hash;
+}
+
+// Integers are sent as base 128 varints, so small values are a single byte
+static inline int log_put_varint(unsigned char *data, int used, unsigned int value) {
+  unsigned char bytes[5];
+  int n = 0;
+  do {
+    bytes[n] = value & 0x7F;
+    value >>= 7;
+    if (value) bytes[n] |= 0x80;
+    n++;
+  } while (value);
+  if (used + n > LOG_BINARY_MAX_SIZE) return used;
+  for (int i = 0; i < n; i++) data[used++] = bytes[i];
+  return used;
+}
+
+// Zigzag encoding, so small negative numbers are also small varints
+#define LOG_ZIGZAG(value) (((unsigned int) (value) << 1) ^ (unsigned int) ((value) >> 31))
+
+int _LogBinary(int type, unsigned int *format_id, char *fmt, ...) {
+  #if defined(DEBUG_MODE)
+  // Nothing decodes the packets locally, so print the text instead
+  char buf[512];
+  va_list text_va;
+  va_start(text_va, fmt);
+  jformat(buf, 512, fmt, text_va);
+  va_end(text_va);
+  return _Logs(type, buf);
+  #endif
+
+  if (logging_warehouse_tid == -1) {
+    KASSERT(false, "Logging relay not initialized");
+    return -1;
+  }
+
+  if (*format_id == 0) {
+    *format_id = log_format_hash(fmt);
+  }
+
+  char request_buffer[sizeof(uart_packet_t) + LOG_BINARY_MAX_SIZE] __attribute__ ((aligned (4)));
+  uart_packet_t *packet = (uart_packet_t *) request_buffer;
+  unsigned char *data = (unsigned char *) request_buffer + sizeof(uart_packet_t);
+  int used = 0;
+  data[used++] = type & 0xFF;
+  data[used++] = *format_id & 0xFF;
+  data[used++] = (*format_id >> 8) & 0xFF;
+  data[used++] = (*format_id >> 16) & 0xFF;
+  data[used++] = (*format_id >> 24) & 0xFF;
+
+  // Walk the format with the same grammar as jformat, copying out arguments
+  va_list va;
+  va_start(va, fmt);
+  char ch;
+  while ((ch = *(fmt++))) {
+    if (ch != '%') continue;
+    ch = *(fmt++);
+    if (ch == '-') ch = *(fmt++);
+    while (ch >= '0' && ch <= '9') ch = *(fmt++);
+    if (ch == 0) break;
+    switch (ch) {
+      case 'c': {
+        char c = (char) va_arg(va, int);
+        if (used < LOG_BINARY_MAX_SIZE) data[used++] = c;
+        break;
+      }
+      case 's': {
+        const char *str = va_arg(va, const char *);
+        int len = jstrlen(str);
+        if (used >= LOG_BINARY_MAX_SIZE) break;
+        if (len > LOG_BINARY_MAX_SIZE - used - 1) len = LOG_BINARY_MAX_SIZE - used - 1;
+        // a single unsigned length byte, as tools/log_decode reads it
+        if (len > 255) len = 255;
+        data[used++] = len;
+        jmemcpy(data + used, str, len);
+        used += len;
+        break;
+      }
+      case 'u':
+      case 'x':
+        used = log_put_varint(data, used, va_arg(va, unsigned int));
+        break;
+      case 'd': {
+        int value = va_arg(va, int);
+        used = log_put_varint(data, used, LOG_ZIGZAG(value));
+        break;
+      }
+      case 'l': {
+        int value = (int) va_arg(va, long int);
+        used = log_put_varint(data, used, LOG_ZIGZAG(value));
+        break;
+      }
+    }
+  }
+  va_end(va);
+
+  packet->type = PACKET_LOG_BINARY;
+  packet->len = used;
+  Send(logging_warehouse_tid, request_buffer, sizeof(uart_packet_t) + used, NULL, 0);
+  return 0;
 }
 
 
-int Logs(int type, const char *str) {
+int _Logs(int type, const char *str) {
   #if defined(DEBUG_MODE)
   // Output to STDOUT for local
   bwputstr(COM2, str);
@@ -366,16 +609,20 @@ int Logs(int type, const char *str) {
   }
 
   int slen = jstrlen(str);
-  char message_buffer[1024] __attribute__ ((aligned (4)));;
-  uart_packet_t * packet = (uart_packet_t *) message_buffer;
-  char * packet_data = message_buffer + sizeof(uart_packet_t);
-  packet->type = type;
-  packet->len = slen;
-  jmemcpy(packet_data, str, slen*sizeof(char));
+  uart_packet_t packet;
+  packet.type = type;
+  packet.len = slen;
 
   int size = sizeof(uart_packet_t) + slen;
   KASSERT(size <= 1024, "Message buffer overflow. Re-evaluate buffer sizes");
-  Send(logging_warehouse_tid, message_buffer, size, NULL, 0);
+
+  // the kernel gathers the header and string straight into the warehouse
+  iovec_t iov[2];
+  iov[0].base = &packet;
+  iov[0].len = sizeof(uart_packet_t);
+  iov[1].base = str;
+  iov[1].len = slen;
+  SendV(logging_warehouse_tid, iov, 2, NULL, 0);
   return 0;
 }
 
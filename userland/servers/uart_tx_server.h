@@ -1,5 +1,8 @@
 #pragma once
 
+#include <kernel.h>
+#include <latency_probe.h>
+
 #define RESPONSE_BUFFER_SIZE 16
 
 #define PACKET_SENSOR_DATA 10
@@ -12,12 +15,52 @@
 #define PACKET_RESEVOIR_UNSET_DATA 26
 
 #define PACKET_LOG_INFO 90
+#define PACKET_LOG_BINARY 91
 
 // Log types
 #define UPTIME_LOGGING 100
 #define IDLE_LOGGING 101
 #define EXECUTOR_LOGGING 150
 
+/*
+ * Log categories
+ *
+ * Every log type belongs to a category. A category that isn't in
+ * LOG_COMPILED_CATEGORIES is compiled out of Logf and Logs entirely, and one
+ * that is can be turned off at runtime with SetLogMask. In both cases the
+ * message is dropped before it is formatted or sent, and only counted
+ */
+#define LOG_CATEGORY_UPTIME 0
+#define LOG_CATEGORY_IDLE 1
+#define LOG_CATEGORY_EXECUTOR 2
+#define LOG_CATEGORY_INFO 3
+#define LOG_CATEGORY_OTHER 4
+#define LOG_NUM_CATEGORIES 5
+
+#define LOG_BIT(category) (1 << (category))
+#define LOG_ALL_CATEGORIES (LOG_BIT(LOG_NUM_CATEGORIES) - 1)
+
+// Categories which are compiled in, e.g. for production
+// (LOG_ALL_CATEGORIES & ~LOG_BIT(LOG_CATEGORY_EXECUTOR))
+#define LOG_COMPILED_CATEGORIES LOG_ALL_CATEGORIES
+
+#define LOG_CATEGORY(type) ( \
+  (type) == UPTIME_LOGGING ? LOG_CATEGORY_UPTIME : \
+  (type) == IDLE_LOGGING ? LOG_CATEGORY_IDLE : \
+  (type) == EXECUTOR_LOGGING ? LOG_CATEGORY_EXECUTOR : \
+  (type) == PACKET_LOG_INFO ? LOG_CATEGORY_INFO : \
+  LOG_CATEGORY_OTHER)
+
+// Runtime enabled categories, shared by all tasks
+extern volatile unsigned int log_enabled_mask;
+// Messages dropped by each category, compiled out or not
+extern volatile unsigned int log_suppressed[LOG_NUM_CATEGORIES];
+
+// The compiled in check is constant for a constant type, so a compiled out
+// Logf is only a counter increment
+#define LOG_ENABLED(type) \
+  ((LOG_BIT(LOG_CATEGORY(type)) & LOG_COMPILED_CATEGORIES) && (LOG_BIT(LOG_CATEGORY(type)) & log_enabled_mask))
+
 
 typedef struct {
   int len;
@@ -35,17 +78,95 @@ void uart_tx();
 int Putc(int channel, const char c );
 int Putstr(int channel, const char *str);
 int Putcs(int channel, const char *c, int len);
+
+/**
+ * Putcs for a command pipeline, stamping the probe as written and queued.
+ * The probe is ended as sent once its last byte leaves the UART
+ * @param  channel must be COM1 if there is a probe
+ * @param  probe   of PROBE_PIPELINE_COMMAND, or NULL
+ * @return         0 on success
+ */
+int PutcsProbed(int channel, const char *c, int len, latency_probe_t *probe);
 int Puti(int channel, int i);
 int Putf(int channel, char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
 int PutPacket(uart_packet_t *packet);
 
+/**
+ * Sends a packet of the given type made of several data fragments, without
+ * assembling the header and fragments into one buffer
+ */
+int PutPacketV(int type, const iovec_t *data, int datacnt);
+
 #define PutFixedPacket(packet) do { \
   KASSERT((packet)->len <= RESPONSE_BUFFER_SIZE, "UART fixed packet overflown. Adjust size or use the variable sized one."); \
   PutPacket((uart_packet_t *) packet); \
 } while (0)
 
 int Logp(uart_packet_t *packet);
-int Logs(int type, const char *str);
-int Logf(int type, char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+int _Logs(int type, const char *str);
+int _Logf(int type, char *fmt, ...) __attribute__ ((format (printf, 2, 3)));
+
+static inline int LogSuppressed(int type) {
+  log_suppressed[LOG_CATEGORY(type)]++;
+  return 0;
+}
+
+/*
+ * Binary logging
+ *
+ * Under NONTERMINAL_OUTPUT, Logf doesn't format anything on the device.
+ * Instead it sends a PACKET_LOG_BINARY packet holding the log type, the id
+ * of the format string and the raw arguments, which tools/log_decode turns
+ * back into text using a table of every Logf format in the source. The id is
+ * a 32-bit FNV-1a hash of the format, so Logf formats must be string literals
+ *
+ * Packet data, little endian:
+ *   1 byte   log type
+ *   4 bytes  format id
+ *   then for each conversion of the format
+ *     %c        1 byte
+ *     %u %x     varint, 7 bits per byte with the top bit set on all but
+ *               the last byte
+ *     %d %l     zigzag encoded varint, (n << 1) ^ (n >> 31)
+ *     %s        1 byte length, then the characters without a terminator
+ *
+ * Arguments that don't fit in a packet are truncated, and as nothing is
+ * formatted these lines also aren't kept by RecordLog
+ */
+#define LOG_BINARY NONTERMINAL_OUTPUT
+
+// Largest binary log packet data, packets to COM2 must be under 256 bytes
+#define LOG_BINARY_MAX_SIZE 255
+
+/**
+ * Sends a binary log packet, see Binary logging. Use Logf instead
+ * @param  type      of log
+ * @param  format_id cache for the hash of fmt, computed on first use
+ * @param  fmt       printf format, must be a string literal
+ * @return           0 on success
+ */
+int _LogBinary(int type, unsigned int *format_id, char *fmt, ...) __attribute__ ((format (printf, 3, 4)));
+
+#define Logs(type, str) (LOG_ENABLED(type) ? _Logs(type, str) : LogSuppressed(type))
+#if LOG_BINARY
+// Every call site hashes its format once, into its own static
+#define Logf(type, fmt, ...) ({ \
+  static unsigned int _log_format_id = 0; \
+  LOG_ENABLED(type) ? _LogBinary(type, &_log_format_id, fmt, ##__VA_ARGS__) : LogSuppressed(type); \
+})
+#else
+#define Logf(type, ...) (LOG_ENABLED(type) ? _Logf(type, __VA_ARGS__) : LogSuppressed(type))
+#endif
+
+/**
+ * Sets the log categories enabled at runtime
+ * @param mask of LOG_BIT(category), categories not compiled in stay off
+ */
+void SetLogMask(unsigned int mask);
+
+/**
+ * @return the total messages suppressed across all categories
+ */
+unsigned int LogSuppressedTotal();
 void MoveTerminalCursor(unsigned int x, unsigned int y);
 int GetRxQueueLength(int channel);
@@ -9,8 +9,6 @@ bool pathing_initialized = false;
 
 track_node track[TRACK_MAX];
 
-void initSensorDistances();
-
 void InitPathing() {
   int i;
   pathing_initialized = true;
@@ -116,12 +114,12 @@ node_dist_t findSensorOrBranch(int start) {
 }
 
 track_edge *nextEdge(int node) {
-  KASSERT(node >= 0 && node <= 143, "Invalid starting node, %d", node);
+  KASSERT_DEBUG(TRACK, node >= 0 && node <= 143, "Invalid starting node, %d", node);
   if (track[node].type == NODE_EXIT) {
     return NULL;
   } else if (track[node].type == NODE_BRANCH) {
     int state = GetSwitchState(track[node].num);
-    KASSERT(state == DIR_STRAIGHT || state == DIR_CURVED, "Invalid switch state, %d", state);
+    KASSERT_DEBUG(TRACK, state == DIR_STRAIGHT || state == DIR_CURVED, "Invalid switch state, %d", state);
     return &track[node].edge[state];
   } else {
     return &track[node].edge[DIR_AHEAD];
@@ -195,6 +193,23 @@ int GetReverseNode(int node) {
  */
 volatile int global_pathing_idx = 1;
 
+/**
+ * Checks each node of a path follows the last over an edge, with node_dist
+ * adding up along them. This walks every edge of the path
+ */
+static bool path_is_connected(path_t *p) {
+  for (int i = 1; i < p->len; i++) {
+    track_node *prev = p->nodes[i - 1];
+    int dist = -1;
+    int edges = prev->type == NODE_BRANCH ? 2 : prev->type == NODE_EXIT ? 0 : 1;
+    for (int dir = 0; dir < edges; dir++) {
+      if (prev->edge[dir].dest == p->nodes[i]) dist = prev->edge[dir].dist;
+    }
+    if (dist == -1 || p->node_dist[i] != p->node_dist[i - 1] + dist) return false;
+  }
+  return true;
+}
+
 void GetPathWithResv(path_t *p, int src, int dest, int resv_owner) {
   KASSERT(src >= 0 && dest >= 0, "Bad src or dest: got src=%d dest=%d", src, dest);
   track_node *nodes[TRACK_MAX];
@@ -228,6 +243,7 @@ void GetPathWithResv(path_t *p, int src, int dest, int resv_owner) {
       p->nodes[i] = nodes[i];
       p->node_dist[i] = nodes[i]->p_dist[pathing_idx];
     }
+    KASSERT_PARANOID(TRACK, path_is_connected(p), "Generated path isn't connected by edges for %4s ~> %4s", track[src].name, track[dest].name);
   }
 
   // // check for more optimal normal src, reverse dest
@@ -37,6 +37,9 @@ typedef struct {
 // Initializes the track information
 void InitPathing();
 
+// Precomputes the distances between adjacent sensors, done by InitPathing
+void initSensorDistances();
+
 // Gets the distance between adjacent sensors. Precomputed for speed.
 int adjSensorDist(int last, int current);
 
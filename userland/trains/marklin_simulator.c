@@ -0,0 +1,354 @@
+#include <basic.h>
+#include <io.h>
+#include <trains/marklin_simulator.h>
+#include <trains/navigation.h>
+#include <track/pathing.h>
+
+#if defined(DEBUG_MODE)
+
+#define SIMULATOR_MODULES 5
+// Switch numbers fit in the byte after a switch command
+#define SIMULATOR_SWITCHES 256
+
+// Trains are moved in fixed steps, so they move the same for any polling
+#define SIMULATOR_STEP_US 1000
+
+// Commands, the other bytes are speeds or sensor dumps
+#define COMMAND_REVERSE 15
+#define COMMAND_SOLENOID_OFF 32
+#define COMMAND_SWITCH_STRAIGHT 33
+#define COMMAND_SWITCH_CURVED 34
+#define COMMAND_GO 0x60
+#define COMMAND_STOP 0x61
+#define COMMAND_DUMP 0x80
+#define COMMAND_DUMP_MODULE 0xC0
+
+typedef struct {
+  bool placed;
+  int speed;
+  // the node at the start of the edge the train is on
+  track_node *node;
+  // NULL once the train ran into an exit
+  track_edge *edge;
+  // along the edge, in nm
+  long long offset;
+  // in um/s
+  int velocity;
+
+  // in mm/s and mm/s^2
+  int velocities[SIMULATOR_SPEEDS];
+  int accelerations[SIMULATOR_SPEEDS];
+} simulated_train_t;
+
+// Roughly the average of the calibrated trains in navigation.c
+static const int default_velocities[SIMULATOR_SPEEDS] = {
+  0, 20, 45, 75, 115, 160, 205, 250, 310, 370, 430, 480, 530, 570, 600
+};
+#define DEFAULT_ACCELERATION 200
+
+static simulated_train_t trains[TRAINS_MAX];
+
+static bool switch_curved[SIMULATOR_SWITCHES];
+static bool switch_broken[SIMULATOR_SWITCHES];
+static bool sensor_triggered[SIMULATOR_SENSORS];
+static bool sensor_broken[SIMULATOR_SENSORS];
+
+static int sensor_miss_rate;
+static int sensor_spurious_rate;
+static int switch_failure_rate;
+static unsigned int random_state;
+
+static bool running;
+static long long simulated_until;
+// first byte of a two byte command, or -1
+static int pending_command;
+
+static bool fault(int rate) {
+  if (rate <= 0) return false;
+  random_state = random_state * 1103515245 + 12345;
+  return (int) ((random_state >> 16) % 1000) < rate;
+}
+
+static void sensor_hit(int sensor) {
+  if (sensor < 0 || sensor >= SIMULATOR_SENSORS) return;
+  if (sensor_broken[sensor] || fault(sensor_miss_rate)) return;
+  sensor_triggered[sensor] = true;
+}
+
+static track_edge *next_edge(track_node *node) {
+  switch (node->type) {
+  case NODE_EXIT:
+    return NULL;
+  case NODE_BRANCH:
+    return &node->edge[switch_curved[node->num] ? DIR_CURVED : DIR_STRAIGHT];
+  default:
+    return &node->edge[DIR_AHEAD];
+  }
+}
+
+static void train_step(simulated_train_t *t) {
+  if (!running) {
+    // the track has no power, so trains stop dead
+    t->velocity = 0;
+    return;
+  }
+
+  // mm/s^2 over a 1ms step is the change in um/s
+  int target = t->velocities[t->speed] * 1000;
+  int acceleration = t->accelerations[t->speed] * (SIMULATOR_STEP_US / 1000);
+  if (t->velocity < target) {
+    t->velocity = t->velocity + acceleration < target ? t->velocity + acceleration : target;
+  } else if (t->velocity > target) {
+    t->velocity = t->velocity - acceleration > target ? t->velocity - acceleration : target;
+  }
+
+  if (t->edge == NULL) {
+    t->velocity = 0;
+    return;
+  }
+
+  // um/s over a 1ms step is the distance in nm
+  t->offset += (long long) t->velocity * (SIMULATOR_STEP_US / 1000);
+  while (t->edge != NULL && t->offset >= t->edge->dist * 1000000LL) {
+    t->offset -= t->edge->dist * 1000000LL;
+    t->node = t->edge->dest;
+    if (t->node->type == NODE_SENSOR) {
+      sensor_hit(t->node->num);
+    }
+    t->edge = next_edge(t->node);
+    if (t->edge == NULL) {
+      t->offset = 0;
+      t->velocity = 0;
+    }
+  }
+}
+
+static void simulate_until(long long now) {
+  while (simulated_until + SIMULATOR_STEP_US <= now) {
+    for (int i = 0; i < TRAINS_MAX; i++) {
+      if (trains[i].placed) train_step(&trains[i]);
+    }
+    simulated_until += SIMULATOR_STEP_US;
+  }
+}
+
+static void train_reverse(simulated_train_t *t) {
+  if (t->edge != NULL) {
+    track_edge *edge = t->edge;
+    t->node = edge->dest->reverse;
+    t->edge = edge->reverse;
+    t->offset = edge->dist * 1000000LL - t->offset;
+  } else {
+    t->node = t->node->reverse;
+    t->edge = next_edge(t->node);
+    t->offset = 0;
+  }
+  // the train stops to reverse, and then carries on at its speed
+  t->velocity = 0;
+}
+
+static void speed_command(int command, int train) {
+  if (train < 0 || train >= TRAINS_MAX) return;
+  simulated_train_t *t = &trains[train];
+  // +16 turns the lights on, which doesn't change how the train moves
+  command &= 15;
+  if (command == COMMAND_REVERSE) {
+    if (t->placed) train_reverse(t);
+  } else {
+    t->speed = command;
+  }
+}
+
+static void switch_command(int command, int sw) {
+  if (switch_broken[sw] || fault(switch_failure_rate)) return;
+  switch_curved[sw] = command == COMMAND_SWITCH_CURVED;
+}
+
+static void dump_module(int module) {
+  char high = 0;
+  char low = 0;
+  if (module < SIMULATOR_MODULES) {
+    // sensor 1 of a module is the highest bit of the high byte
+    for (int i = 0; i < 8; i++) {
+      int sensor = module * 16 + i;
+      if (sensor_triggered[sensor]) high |= 0x80 >> i;
+      if (sensor_triggered[sensor + 8]) low |= 0x80 >> i;
+      sensor_triggered[sensor] = false;
+      sensor_triggered[sensor + 8] = false;
+    }
+  }
+  io_device_receive(COM1, high);
+  io_device_receive(COM1, low);
+}
+
+static void dump_command(int command) {
+  if (fault(sensor_spurious_rate)) {
+    random_state = random_state * 1103515245 + 12345;
+    sensor_triggered[(random_state >> 16) % SIMULATOR_SENSORS] = true;
+  }
+  if (command > COMMAND_DUMP_MODULE) {
+    // modules are numbered from 1
+    dump_module((command & 0x1F) - 1);
+  } else {
+    for (int i = 0; i < (command & 0x1F); i++) {
+      dump_module(i);
+    }
+  }
+}
+
+static void simulator_receive(char c) {
+  int byte = (unsigned char) c;
+  simulate_until(io_device_time_us());
+
+  if (pending_command != -1) {
+    int command = pending_command;
+    pending_command = -1;
+    if (command == COMMAND_SWITCH_STRAIGHT || command == COMMAND_SWITCH_CURVED) {
+      switch_command(command, byte);
+    } else {
+      speed_command(command, byte);
+    }
+    return;
+  }
+
+  if (byte < COMMAND_SOLENOID_OFF || byte == COMMAND_SWITCH_STRAIGHT || byte == COMMAND_SWITCH_CURVED) {
+    pending_command = byte;
+  } else if (byte == COMMAND_GO) {
+    running = true;
+  } else if (byte == COMMAND_STOP) {
+    running = false;
+  } else if ((byte > COMMAND_DUMP && byte < COMMAND_DUMP + 32) || (byte > COMMAND_DUMP_MODULE && byte < COMMAND_DUMP_MODULE + 32)) {
+    // 0x80 and 0xC0 set the reset mode, the modules are always in reset
+    // mode here as that's how they're used
+    dump_command(byte);
+  }
+  // COMMAND_SOLENOID_OFF, and anything unknown, doesn't change anything
+}
+
+void InitMarklinSimulator() {
+  for (int i = 0; i < TRAINS_MAX; i++) {
+    trains[i].placed = false;
+    trains[i].speed = 0;
+    trains[i].velocity = 0;
+    for (int s = 0; s < SIMULATOR_SPEEDS; s++) {
+      trains[i].velocities[s] = default_velocities[s];
+      trains[i].accelerations[s] = DEFAULT_ACCELERATION;
+    }
+  }
+  for (int i = 0; i < SIMULATOR_SWITCHES; i++) {
+    switch_curved[i] = false;
+    switch_broken[i] = false;
+  }
+  for (int i = 0; i < SIMULATOR_SENSORS; i++) {
+    sensor_triggered[i] = false;
+    sensor_broken[i] = false;
+  }
+  SimulatorSetFaults(0, 0, 0, 1);
+
+  running = true;
+  simulated_until = io_device_time_us();
+  pending_command = -1;
+  io_device_set_output(COM1, simulator_receive);
+}
+
+void SimulatorPlaceTrain(int train, int node) {
+  KASSERT(train >= 0 && train < TRAINS_MAX, "Cannot place out of bounds train. Got train=%d", train);
+  KASSERT(node >= 0 && node < TRACK_MAX, "Cannot place train=%d on bad node=%d", train, node);
+  simulate_until(io_device_time_us());
+  simulated_train_t *t = &trains[train];
+  t->placed = true;
+  t->speed = 0;
+  t->velocity = 0;
+  t->node = &track[node];
+  t->edge = next_edge(t->node);
+  t->offset = 0;
+}
+
+void SimulatorSetSpeedProfile(int train, int speed, int velocity, int acceleration) {
+  KASSERT(train >= -1 && train < TRAINS_MAX, "Cannot profile out of bounds train. Got train=%d", train);
+  KASSERT(speed >= 0 && speed < SIMULATOR_SPEEDS, "Cannot profile bad speed=%d", speed);
+  for (int i = 0; i < TRAINS_MAX; i++) {
+    if (train == -1 || train == i) {
+      trains[i].velocities[speed] = velocity;
+      trains[i].accelerations[speed] = acceleration;
+    }
+  }
+}
+
+void SimulatorSetFaults(int sensor_miss, int sensor_spurious, int switch_failure, unsigned int seed) {
+  sensor_miss_rate = sensor_miss;
+  sensor_spurious_rate = sensor_spurious;
+  switch_failure_rate = switch_failure;
+  random_state = seed;
+}
+
+void SimulatorBreakSensor(int sensor, bool broken) {
+  KASSERT(sensor >= 0 && sensor < SIMULATOR_SENSORS, "Cannot break bad sensor=%d", sensor);
+  sensor_broken[sensor] = broken;
+}
+
+void SimulatorBreakSwitch(int sw, bool broken) {
+  KASSERT(sw >= 0 && sw < SIMULATOR_SWITCHES, "Cannot break bad switch=%d", sw);
+  switch_broken[sw] = broken;
+}
+
+int SimulatorTrainLocation(int train) {
+  KASSERT(train >= 0 && train < TRAINS_MAX, "Cannot locate out of bounds train. Got train=%d", train);
+  if (!trains[train].placed) return -1;
+  simulate_until(io_device_time_us());
+  return trains[train].node->id;
+}
+
+int SimulatorTrainVelocity(int train) {
+  KASSERT(train >= 0 && train < TRAINS_MAX, "Cannot get velocity of out of bounds train. Got train=%d", train);
+  if (!trains[train].placed) return 0;
+  simulate_until(io_device_time_us());
+  return trains[train].velocity / 1000;
+}
+
+static bool is_node(track_node *node, int id) {
+  return node->id == id || node->reverse->id == id;
+}
+
+// Walks forward from the start of an edge, following the switches
+static int distance_ahead(track_edge *edge, int id, int travelled) {
+  while (edge != NULL && travelled < SIMULATOR_SEARCH_MAX) {
+    travelled += edge->dist;
+    if (is_node(edge->dest, id)) return travelled;
+    edge = next_edge(edge->dest);
+  }
+  return -1;
+}
+
+int SimulatorTrainOffset(int train, int node, int *offset) {
+  KASSERT(train >= 0 && train < TRAINS_MAX, "Cannot measure out of bounds train. Got train=%d", train);
+  KASSERT(node >= 0 && node < TRACK_MAX, "Cannot measure train=%d from bad node=%d", train, node);
+  simulated_train_t *t = &trains[train];
+  if (!t->placed) return -1;
+  simulate_until(io_device_time_us());
+  int travelled = (int) (t->offset / 1000000LL);
+  if (is_node(t->node, node)) {
+    *offset = travelled;
+    return 0;
+  }
+
+  // the node ahead of the train, which it stopped short of
+  if (t->edge != NULL) {
+    int distance = distance_ahead(t->edge, node, -travelled);
+    if (distance != -1) {
+      *offset = -distance;
+      return 0;
+    }
+  }
+
+  // the node behind the train, which it overshot. Facing backwards the
+  // switches are still set the way the train came through them
+  int distance = distance_ahead(next_edge(t->node->reverse), node, travelled);
+  if (distance != -1) {
+    *offset = distance;
+    return 0;
+  }
+  return -1;
+}
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+/**
+ * Märklin train controller and track simulator (x86 only)
+ *
+ * Sits behind the simulated UART1, so the train code talks to it with the
+ * same bytes it sends the real controller:
+ *   speed  [0-14 (+16 for lights), train], 15 reverses the train
+ *   switch [33 straight | 34 curved, switch], 32 turns the solenoid off
+ *   0x80+n dumps sensor modules 1..n, 0xC0+n dumps only module n
+ *   0x60 go, 0x61 stop
+ *
+ * Trains are placed on a node of the track graph from InitPathing, and move
+ * along it following the switches at every branch. A train approaches the
+ * velocity of its speed at the acceleration of that speed, so the
+ * acceleration of speed 0 is how it stops. Sensors hit since the last dump
+ * are latched until dumped, like the real sensor modules in reset mode.
+ *
+ * Faults can be injected for testing attribution: sensors which miss a
+ * train or trigger without one, and switches which don't throw.
+ */
+
+#include <basic.h>
+
+#if defined(DEBUG_MODE)
+
+// Speeds of the controller, 15 is the reverse command
+#define SIMULATOR_SPEEDS 15
+// Sensors are also the first nodes of the track
+#define SIMULATOR_SENSORS 80
+
+// How far SimulatorTrainOffset looks for a node, in mm
+#define SIMULATOR_SEARCH_MAX 5000
+
+/**
+ * Starts the simulator as the output of COM1. Call after InitPathing, the
+ * simulator runs on the same track
+ */
+void InitMarklinSimulator();
+
+/**
+ * Places a train on the track, stopped, replacing any previous placement
+ * @param train number
+ * @param node  the train is at, facing away from
+ */
+void SimulatorPlaceTrain(int train, int node);
+
+/**
+ * Sets how a train moves at a speed
+ * @param train        number, or -1 for every train
+ * @param speed        0 - 14
+ * @param velocity     in mm/s
+ * @param acceleration in mm/s^2, used when changing to this speed
+ */
+void SimulatorSetSpeedProfile(int train, int speed, int velocity, int acceleration);
+
+/**
+ * Sets random faults, in occurrences per 1000. The random numbers are
+ * deterministic for a seed
+ * @param sensor_miss     a sensor doesn't see a train pass it
+ * @param sensor_spurious a sensor dump has a sensor nobody hit
+ * @param switch_failure  a switch command doesn't move the switch
+ * @param seed            for the random numbers
+ */
+void SimulatorSetFaults(int sensor_miss, int sensor_spurious, int switch_failure, unsigned int seed);
+
+/**
+ * Breaks a sensor, so it never triggers
+ */
+void SimulatorBreakSensor(int sensor, bool broken);
+
+/**
+ * Breaks a switch, so it stays in its current direction
+ */
+void SimulatorBreakSwitch(int sw, bool broken);
+
+/**
+ * Gets the node at the start of the edge a train is on, which is the last
+ * node it passed unless it reversed. -1 if it isn't on the track
+ */
+int SimulatorTrainLocation(int train);
+
+/**
+ * Gets how fast a train is going, in mm/s
+ */
+int SimulatorTrainVelocity(int train);
+
+/**
+ * Measures how far a train is past a node, in either direction of the node,
+ * for checking where a train stopped
+ * @param  train  number
+ * @param  node   to measure from
+ * @param  offset in mm, negative if the train hasn't reached the node (OUTPUT)
+ * @return        0 => OK
+ *                -1 => the node isn't within SIMULATOR_SEARCH_MAX of the train
+ */
+int SimulatorTrainOffset(int train, int node, int *offset);
+
+#endif
@@ -21,6 +21,10 @@ int stopping_distance[TRAINS_MAX][15];
 int velocitySamples[TRAINS_MAX][15][VELOCITY_SAMPLES_MAX];
 int velocitySampleStart[TRAINS_MAX][15];
 
+int stopping_distance_factor;
+int stop_distance_offset;
+int switch_time_cutoff;
+
 void InitNavigation() {
   int i;
   navigation_intialized = true;
@@ -94,6 +98,10 @@ void InitNavigation() {
   // calibrated and using as fixture
   velocity[70][5] = 240;
   stopping_distance[70][5] = 230;
+
+  stopping_distance_factor = 15;
+  stop_distance_offset = 150;
+  switch_time_cutoff = 200;
 }
 
 void SetTrainLocation(int train, int location) {
@@ -109,7 +117,7 @@ int WhereAmI(int train) {
 void SetPathSwitches(path_t *p) {
   int i;
   char dir;
-  RecordLogf("SetPathSwitches %s ~> %s\n\r", p->src->name, p->dest->name);
+  FlightRecord("SetPathSwitches %s ~> %s", (intptr_t) p->src->name, (intptr_t) p->dest->name, 0);
   for (i = 0; i < p->len; i++) {
     if (i > 0 && p->nodes[i-1]->type == NODE_BRANCH) {
       if (p->nodes[i-1]->edge[DIR_CURVED].dest == p->nodes[i]) {
@@ -119,7 +127,7 @@ void SetPathSwitches(path_t *p) {
         dir = 'S';
         SetSwitch(p->nodes[i-1]->num, SWITCH_STRAIGHT);
       }
-      RecordLogf("  Setting switch %s to %c", p->nodes[i-1]->name, dir);
+      FlightRecord("  Setting switch %s to %c", (intptr_t) p->nodes[i-1]->name, dir, 0);
     }
   }
 }
@@ -204,7 +212,7 @@ int StoppingDistance(int train, int speed) {
   // This is used for reservations, when we have StopDist 0 we still check stopdist for reserving
   //if (speed == 0) return 0;
   //return 1056 - stopping_distance[train][speed];
-  return (15 * Velocity(train, speed)) / 10;
+  return (stopping_distance_factor * Velocity(train, speed)) / 10;
 }
 
 int CalculateDistance(int velocity, int t) {
@@ -225,8 +233,8 @@ int AccelerationTime(int train, int startingSpeed, int endingSpeed) {
 }
 
 int Velocity(int train, int speed) {
-  KASSERT(train >= 0 && train <= TRAINS_MAX, "Invalid train when getting velocity. Got %d", train);
-  KASSERT(speed >= 0 && speed <= 14, "Invalid speed when getting velocity. Got %d", speed);
+  KASSERT_DEBUG(TRACK, train >= 0 && train <= TRAINS_MAX, "Invalid train when getting velocity. Got %d", train);
+  KASSERT_DEBUG(TRACK, speed >= 0 && speed <= 14, "Invalid speed when getting velocity. Got %d", speed);
   if (speed < 5 && velocity[train][5] != -1) {
     // Assume it goes linear to 0 when < speed 5
     return speed*velocity[train][5]/5;
@@ -18,6 +18,16 @@
 #define SECONDS(amt) MILLISECONDS(amt * 1000)
 #define MILLISECONDS(amt) amt
 
+// Tunables, set to their calibrated values by InitNavigation. Globals so
+// the scenario entry can sweep them
+// The stopping distance is the distance covered in this many tenths of a
+// second at the train's velocity
+extern int stopping_distance_factor;
+// Extra distance kept reserved past the stopping distance, in mm
+extern int stop_distance_offset;
+// How many ticks before a train reaches a switch it's set
+extern int switch_time_cutoff;
+
 /**
  * Initializes calibration information.
  */
@@ -5,6 +5,8 @@
 #include <track/pathing.h>
 #include <servers/uart_tx_server.h>
 #include <servers/clock_server.h>
+#include <servers/nameserver.h>
+#include <server_stats.h>
 
 int reservoir_tid = -1;
 
@@ -39,34 +41,39 @@ void set_segment_owner(segment_t * segment, int owner) {
 
 void put_resevoir_packet(int type, reservoir_segments_t * request, int owner) {
   int time = Time();
-  int msg_buf_len = sizeof(uart_packet_t) + 4 + 1 + RESERVING_LIMIT*2;
-  char message_buffer[msg_buf_len] __attribute__ ((aligned (4)));;
-  uart_packet_t * packet = (uart_packet_t *) message_buffer;
-  char * packet_data = message_buffer + sizeof(uart_packet_t);
-  packet->type = type;
-  packet->len = 5 + request->len*2;
-  jmemcpy(&packet_data[0], &time, sizeof(int));
-  packet_data[4] = owner;
+  char owner_data = owner;
+  char segment_data[RESERVING_LIMIT*2];
   KASSERT(request->len < RESERVING_LIMIT, "Trying to reserve too many segments, %d", request->len);
-  for (int i = 0; i < request->len && i < RESERVING_LIMIT; i++) {
-    packet_data[5+2*i] = (char)request->segments[i].track_node;
-    packet_data[5+2*i+1] = (char)track[request->segments[i].track_node].edge[request->segments[i].dir].dest->id;
+  int len = request->len < RESERVING_LIMIT ? request->len : RESERVING_LIMIT;
+  for (int i = 0; i < len; i++) {
+    segment_data[2*i] = (char)request->segments[i].track_node;
+    segment_data[2*i+1] = (char)track[request->segments[i].track_node].edge[request->segments[i].dir].dest->id;
   }
-  PutPacket(packet);
+
+  // packet data is time (4 bytes), owner (1 byte), then src/dest pairs
+  iovec_t data[3];
+  data[0].base = &time;
+  data[0].len = sizeof(int);
+  data[1].base = &owner_data;
+  data[1].len = 1;
+  data[2].base = segment_data;
+  data[2].len = len*2;
+  PutPacketV(type, data, 3);
 }
 
 void put_resevoir_packet_one_item(int type, int src_node, int dest_node, int owner) {
   int time = Time();
-  char message_buffer[32] __attribute__ ((aligned (4)));;
-  uart_packet_t * packet = (uart_packet_t *) message_buffer;
-  char * packet_data = message_buffer + sizeof(uart_packet_t);
-  packet->type = type;
-  packet->len = 7;
-  jmemcpy(&packet_data[0], &time, sizeof(int));
-  packet_data[4] = owner;
-  packet_data[5] = (char)src_node;
-  packet_data[6] = (char)dest_node;
-  PutPacket(packet);
+  char segment_data[3];
+  segment_data[0] = owner;
+  segment_data[1] = (char)src_node;
+  segment_data[2] = (char)dest_node;
+
+  iovec_t data[2];
+  data[0].base = &time;
+  data[0].len = sizeof(int);
+  data[1].base = segment_data;
+  data[1].len = 3;
+  PutPacketV(type, data, 2);
 }
 
 void set_segment_ownership(reservoir_segments_t * request, int owner) {
@@ -118,6 +125,10 @@ static void process_pathing_request(path_t * path, pathing_request_t * request,
 void reservoir_task() {
   int tid = MyTid();
   reservoir_tid = tid;
+  RegisterAs(NS_RESERVOIR);
+
+  server_stats_t stats;
+  server_stats_init(&stats);
 
   char request_buffer[512] __attribute__ ((aligned (4)));
   KASSERT(sizeof(request_buffer) >= sizeof(reservoir_segments_t), "Buffer isn't large enough.");
@@ -130,6 +141,10 @@ void reservoir_task() {
   int sender;
   while (true) {
     Receive(&sender, request_buffer, sizeof(request_buffer));
+    if (server_stats_handle_query(&stats, sender, packet->type)) {
+      continue;
+    }
+    server_stats_start(&stats, packet->type);
     switch (packet->type) {
     case RESERVOIR_REQUEST:
       if (all_segments_available(resv_request, resv_request->owner)) {
@@ -159,12 +174,13 @@ void reservoir_task() {
       ReplyS(sender, result_path);
       break;
     }
+    server_stats_end(&stats);
   }
 }
 
 int RequestSegment(reservoir_segments_t *segment) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
-  KASSERT(segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
   KASSERT(segment->len >= 0 && segment->len < RESERVING_LIMIT, "Segment overflowed. size=%d max=%d", segment->len, RESERVING_LIMIT);
   // TODO: kassert valid segments and directions
   segment->packet.type = RESERVOIR_REQUEST;
@@ -184,8 +200,8 @@ void edge_segments_to_segments(reservoir_segment_edges_t *segment, reservoir_seg
 }
 
 int RequestSegmentEdges(reservoir_segment_edges_t *segment) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
-  KASSERT(segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
   KASSERT(segment->len >= 0 && segment->len < RESERVING_LIMIT, "Segment overflowed. size=%d max=%d", segment->len, RESERVING_LIMIT);
   // TODO: kassert valid segments and directions
 
@@ -201,8 +217,8 @@ int RequestSegmentEdges(reservoir_segment_edges_t *segment) {
 }
 
 int RequestSegmentEdgesAndReleaseRest(reservoir_segment_edges_t *segment) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
-  KASSERT(segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
   KASSERT(segment->len >= 0 && segment->len < RESERVING_LIMIT, "Segment overflowed. size=%d max=%d", segment->len, RESERVING_LIMIT);
   // TODO: kassert valid segments and directions
 
@@ -218,18 +234,18 @@ int RequestSegmentEdgesAndReleaseRest(reservoir_segment_edges_t *segment) {
 }
 
 void ReleaseSegment(reservoir_segments_t *segment) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
   KASSERT(segment->len >= 0 && segment->len < RESERVING_LIMIT, "Segment overflowed. size=%d max=%d", segment->len, RESERVING_LIMIT);
-  KASSERT(segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
+  KASSERT_DEBUG(RESERVOIR, segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
   // TODO: kassert valid segments and directions
   segment->packet.type = RESERVOIR_RELEASE;
   Send(reservoir_tid, segment, sizeof(reservoir_segments_t), NULL, 0);
 }
 
 void ReleaseSegmentEdges(reservoir_segment_edges_t *segment) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
   KASSERT(segment->len >= 0 && segment->len < RESERVING_LIMIT, "Segment overflowed. size=%d max=%d", segment->len, RESERVING_LIMIT);
-  KASSERT(segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
+  KASSERT_DEBUG(RESERVOIR, segment->owner >= 0 && segment->owner < 80, "Segment owner isn't valid train. Got owner=%d", segment->owner);
 
   reservoir_segments_t actual_segment;
   edge_segments_to_segments(segment, &actual_segment);
@@ -240,7 +256,7 @@ void ReleaseSegmentEdges(reservoir_segment_edges_t *segment) {
 
 
 int RequestPath(path_t * output, int train, int src_node, int dest_node) {
-  KASSERT(reservoir_tid >= 0, "Reservoir not started");
+  KASSERT_DEBUG(RESERVOIR, reservoir_tid >= 0, "Reservoir not started");
   pathing_request_t request;
   request.packet.type = RESERVOIR_PATHING_REQUEST;
   request.train = train;
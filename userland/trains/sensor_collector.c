@@ -43,6 +43,7 @@ void sensor_notifier() {
   ReplyN(requester);
   ReceiveS(&requester, train);
   ReplyN(requester);
+  probe_stamp(&data.probe, PROBE_SENSOR_NOTIFIED);
 
   // Send sensor attribution to UI
   uart_packet_fixed_size_t packet;
@@ -55,7 +56,7 @@ void sensor_notifier() {
 
   // Send sensor attribution to train
   if (train != -1) {
-    AlertTrainController(train, data.sensor_no, data.timestamp);
+    AlertTrainController(train, data.sensor_no, data.timestamp, &data.probe);
   }
 }
 
@@ -238,6 +239,7 @@ void sensor_attributer() {
           { //if (attrib == 71 || attrib == 63){
             // TODO: break this out into a AlertSensorAttribution func
             int notifier = CreateRecyclable(PRIORITY_UART2_TX_SERVER, sensor_notifier);
+            probe_stamp(&data->probe, PROBE_SENSOR_ATTRIBUTED);
             // Send sensor data
             Send(notifier, data, sizeof(sensor_data_t), NULL, 0);
             // Send train attributed to
@@ -266,6 +268,7 @@ void fake_sensor_collector_task() {
     int next = nextSensor(last).node;
     req.timestamp = Time();
     req.sensor_no = next;
+    probe_begin(&req.probe, PROBE_PIPELINE_SENSOR);
     SendSN(sensor_attributer_tid, req);
     // Send to detector multiplexer
     SendSN(sensor_detector_multiplexer_tid, req);
@@ -304,11 +307,12 @@ void sensor_collector_task() {
         continue;
       }
     }
+    probe_begin(&req.probe, PROBE_PIPELINE_SENSOR);
     { // Actually read the bytes from the input buffer
       log_task("sensor_reader reading", tid);
       for (int i = 0; i < 5; i++) {
-        char high = Getc(COM1);
-        char low = Getc(COM1);
+        unsigned char high = Getc(COM1);
+        unsigned char low = Getc(COM1);
         sensors[i] = (high << 8) | low;
       }
     }
@@ -321,6 +325,7 @@ void sensor_collector_task() {
             if ((sensors[i] & (1 << j)) & ~(oldSensors[i] & (1 << j))) {
               // Send to attributer
               req.sensor_no = i*16+(15-j);
+              probe_stamp(&req.probe, PROBE_SENSOR_PARSED);
               SendSN(sensor_attributer_tid, req);
               // Send to detector multiplexer
               SendSN(sensor_detector_multiplexer_tid, req);
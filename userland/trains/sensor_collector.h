@@ -1,12 +1,15 @@
 #pragma once
 
 #include <packet.h>
+#include <latency_probe.h>
 
 typedef struct {
   // type = SENSOR_DATA
   packet_t packet;
   int sensor_no;
   int timestamp;
+  // PROBE_PIPELINE_SENSOR, cleared for triggers not read from the track
+  latency_probe_t probe;
 } sensor_data_t;
 
 void sensor_attributer();
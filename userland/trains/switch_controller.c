@@ -6,6 +6,7 @@
 #include <servers/clock_server.h>
 #include <kernel.h>
 #include <priorities.h>
+#include <server_stats.h>
 
 static int switch_controller_tid = -1;
 
@@ -37,6 +38,9 @@ void switch_controller() {
 
   int solenoid_off_tid = -1;
 
+  server_stats_t stats;
+  server_stats_init(&stats);
+
   int switchState[NUM_SWITCHES];
   for (int i = 0; i < NUM_SWITCHES; i++) {
     switchState[i] = -1;
@@ -44,6 +48,10 @@ void switch_controller() {
 
   while (1) {
     ReceiveS(&requester, request);
+    if (server_stats_handle_query(&stats, requester, request.type)) {
+      continue;
+    }
+    server_stats_start(&stats, request.type);
     if (request.type == SWITCH_GET) {
       int index = switch_to_index(request.index);
       KASSERT(index != -1, "Asked for invalid switch %d by %d", request.index, requester);
@@ -54,15 +62,16 @@ void switch_controller() {
       ReplyS(requester, state);
     } else if (request.type == SWITCH_SET) {
       ReplyN(requester);
+      probe_stamp(&request.probe, PROBE_COMMAND_HANDLED);
       int index = switch_to_index(request.index);
       KASSERT(index != -1, "Asked to set invalid switch %d to %d", request.index, request.value);
       if (switchState[index] != request.value) {
         switchState[index] = request.value;
         buf[1] = request.index;
         if (request.value == SWITCH_CURVED) {
-          buf[0] = 34; Putcs(COM1, buf, 2);
+          buf[0] = 34; PutcsProbed(COM1, buf, 2, &request.probe);
         } else if (request.value == SWITCH_STRAIGHT) {
-          buf[0] = 33; Putcs(COM1, buf, 2);
+          buf[0] = 33; PutcsProbed(COM1, buf, 2, &request.probe);
         }
         if (solenoid_off_tid != -1) {
           Destroy(solenoid_off_tid);
@@ -80,6 +89,7 @@ void switch_controller() {
         }
       }
     }
+    server_stats_end(&stats);
   }
 }
 
@@ -96,6 +106,7 @@ int SetSwitch(int sw, int state) {
   request.type = SWITCH_SET;
   request.index = sw;
   request.value = state;
+  probe_begin(&request.probe, PROBE_PIPELINE_COMMAND);
   SendSN(switch_controller_tid, request);
   return 0;
 }
@@ -112,6 +123,7 @@ int GetSwitchState(int sw) {
   switch_control_request_t request;
   request.type = SWITCH_GET;
   request.index = sw;
+  probe_clear(&request.probe);
   int state;
   SendS(switch_controller_tid, request, state);
   return state;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <latency_probe.h>
+
 enum {
   SWITCH_STRAIGHT,
   SWITCH_CURVED,
@@ -16,9 +18,17 @@ typedef struct {
   int type;
   int index;
   int value;
+  // PROBE_PIPELINE_COMMAND for SWITCH_SET, ended once the command is sent
+  latency_probe_t probe;
 } switch_control_request_t;
 
 void switch_controller();
 
+/**
+ * Gets the index of a switch into the NUM_SWITCHES switches
+ * @return the index, or -1 if sw isn't a switch
+ */
+int switch_to_index(int sw);
+
 int SetSwitch(int sw, int state);
 int GetSwitchState(int sw);
@@ -31,17 +31,26 @@ void InitTrainControllers() {
 typedef struct {
   int train;
   int speed;
+  // only used by train_speed_task
+  latency_probe_t probe;
 } train_task_t;
 
 
-#define DoCommand(command_task, train_val, spd_val) do { \
+#define DoCommandProbed(command_task, train_val, spd_val, probe_ptr) do { \
     int command_tid = CreateRecyclable(PRIORITY_TRAIN_COMMAND_TASK, command_task); \
     train_task_t command_msg; \
     command_msg.train = train_val; \
     command_msg.speed = spd_val; \
+    command_msg.probe = *(probe_ptr); \
     SendSN(command_tid, command_msg); \
   } while(0)
 
+#define DoCommand(command_task, train_val, spd_val) do { \
+    latency_probe_t no_probe; \
+    probe_clear(&no_probe); \
+    DoCommandProbed(command_task, train_val, spd_val, &no_probe); \
+  } while(0)
+
 int path_idx(path_t *path, int node_id) {
   for (int i = 0; i < path->len; i++) {
     if (path->nodes[i]->id == node_id) return i;
@@ -50,7 +59,7 @@ int path_idx(path_t *path, int node_id) {
 }
 
 int offset_stop_dist(int train, int speed) {
-  return StoppingDistance(train, speed) + 150;
+  return StoppingDistance(train, speed) + stop_distance_offset;
 }
 
 int do_navigation_stop(path_t *path, int source_node, int train, int speed) {
@@ -263,7 +272,8 @@ void train_speed_task() {
     int receiver;
     ReceiveS(&receiver, data);
     ReplyN(receiver);
-    #if !defined(DEBUG_MODE)
+    // the probe ends with the first command, as that's when the train reacts
+    latency_probe_t *probe = &data.probe;
     char buf[2];
     buf[1] = data.train;
     if (data.speed > 0) {
@@ -271,14 +281,12 @@ void train_speed_task() {
       if (buf[0] > 14) {
         buf[0] = 14;
       }
-      Putcs(COM1, buf, 2);
+      PutcsProbed(COM1, buf, 2, probe);
+      probe = NULL;
       Delay(10);
     }
     buf[0] = data.speed;
-    Putcs(COM1, buf, 2);
-    #else
-    bwprintf(COM2, "train_speed_task: Would have set train=%d to speed=%d\n", data.train, data.speed);
-    #endif
+    PutcsProbed(COM1, buf, 2, probe);
 }
 
 void reverse_train_task() {
@@ -286,7 +294,6 @@ void reverse_train_task() {
     int receiver;
     ReceiveS(&receiver, data);
     ReplyN(receiver);
-    #if !defined(DEBUG_MODE)
     char buf[2];
     buf[0] = 0;
     buf[1] = data.train;
@@ -302,10 +309,6 @@ void reverse_train_task() {
     Delay(10);
     buf[0] = data.speed;
     Putcs(COM1, buf, 2);
-
-    #else
-    bwprintf(COM2, "reverse_train_task: Would have reversed train=%d then set speed=%d\n", data.train, data.speed);
-    #endif
 }
 
 int get_next_edge_dir(path_t *path, track_node *node) {
@@ -435,7 +438,6 @@ set_switches_result_t set_switches(int train, int speed, path_t *path, int start
   if (next_switch == -1 || (next_branch != -1 && next_branch < next_switch)) {
     next_switch = next_branch;
   }
-  int timeCutoff = 200;
   set_switches_result_t result;
   result.task = -1;
   result.sw = -1;
@@ -450,8 +452,10 @@ set_switches_result_t set_switches(int train, int speed, path_t *path, int start
       int dist = get_next_edge(path, path->nodes[i])->dist;
       total_dist += dist;
     }
-    int time = (100 * total_dist) / Velocity(train, speed);
-    time -= timeCutoff;
+    int velocity = Velocity(train, speed);
+    // a stopped train could start at any moment, so set the switch now
+    int time = velocity > 0 ? (100 * total_dist) / velocity : 0;
+    time -= switch_time_cutoff;
     if (time < 0) {
       time = 0;
     }
@@ -599,7 +603,22 @@ bool gluInvertMatrix(const float m[16], float invOut[16]) {
   return true;
 }
 
-void reserve_segment_pieces(reservoir_segment_edges_t *reserving, int distRemaining, int start, bool found_branch, bool found_sensor, int n) {
+// The state of a switch, from switch_states if given
+static int segment_switch_state(const int *switch_states, int sw) {
+  return switch_states != NULL ? switch_states[switch_to_index(sw)] : GetSwitchState(sw);
+}
+
+// Adds an edge to reserve, unless there are already as many as the reservoir
+// takes at once
+static bool reserving_add(reservoir_segment_edges_t *reserving, track_edge *edge) {
+  if (reserving->len >= RESERVING_LIMIT - 1) return false;
+  reserving->edges[reserving->len] = edge;
+  reserving->len++;
+  return true;
+}
+
+// Returns -1 if there were too many segments to reserve at once
+int reserve_segment_pieces(reservoir_segment_edges_t *reserving, int distRemaining, int start, bool found_branch, bool found_sensor, int n, const int *switch_states) {
   int curr_node = start;
   int total_dist = 0;
   do {
@@ -608,17 +627,15 @@ void reserve_segment_pieces(reservoir_segment_edges_t *reserving, int distRemain
       break;
     } else if (track[curr_node].type == NODE_BRANCH) {
       if (found_branch) {
-        int state = GetSwitchState(track[curr_node].num);
+        int state = segment_switch_state(switch_states, track[curr_node].num);
         edge = &track[curr_node].edge[state];
       } else {
-        reserving->edges[reserving->len] = &track[curr_node].edge[DIR_STRAIGHT];
-        reserving->len++;
-        reserve_segment_pieces(reserving, distRemaining - track[curr_node].edge[DIR_STRAIGHT].dist,
-            track[curr_node].edge[DIR_STRAIGHT].dest->id, true, false, n+1);
-        reserving->edges[reserving->len] = &track[curr_node].edge[DIR_CURVED];
-        reserving->len++;
-        reserve_segment_pieces(reserving, distRemaining - track[curr_node].edge[DIR_CURVED].dist,
-            track[curr_node].edge[DIR_CURVED].dest->id, true, false, n+1);
+        if (!reserving_add(reserving, &track[curr_node].edge[DIR_STRAIGHT])) return -1;
+        if (reserve_segment_pieces(reserving, distRemaining - track[curr_node].edge[DIR_STRAIGHT].dist,
+            track[curr_node].edge[DIR_STRAIGHT].dest->id, true, false, n+1, switch_states) == -1) return -1;
+        if (!reserving_add(reserving, &track[curr_node].edge[DIR_CURVED])) return -1;
+        if (reserve_segment_pieces(reserving, distRemaining - track[curr_node].edge[DIR_CURVED].dist,
+            track[curr_node].edge[DIR_CURVED].dest->id, true, false, n+1, switch_states) == -1) return -1;
         break;
       }
     } else {
@@ -628,8 +645,7 @@ void reserve_segment_pieces(reservoir_segment_edges_t *reserving, int distRemain
       edge = &track[curr_node].edge[DIR_AHEAD];
     }
     if (edge != NULL) {
-      reserving->edges[reserving->len] = edge;
-      reserving->len++;
+      if (!reserving_add(reserving, edge)) return -1;
       if (!found_branch || (found_branch && found_sensor)) {
         total_dist += edge->dist;
       }
@@ -638,22 +654,32 @@ void reserve_segment_pieces(reservoir_segment_edges_t *reserving, int distRemain
       break;
     }
   } while (total_dist < distRemaining);
+  return 0;
 }
 
 #define reserve_next_segments(path, train, speed, node) reserve_next_segments_offset(path, train, speed, node, 0)
 
-int reserve_next_segments_offset(path_t *path, int train, int speed, int node, int offset) {
+int next_segments_offset(reservoir_segment_edges_t *reserving, int train, int speed, int node, int offset, const int *switch_states) {
   int stopdist = offset_stop_dist(train, speed) + offset;
-  reservoir_segment_edges_t reserving;
-  reserving.len = 0;
-  reserving.owner = train;
-  bool found_another_sensor = false;
+  reserving->len = 0;
+  reserving->owner = train;
 
-  track_edge *next_edge = nextEdge(node);
+  track_edge *next_edge;
+  if (track[node].type == NODE_BRANCH) {
+    next_edge = &track[node].edge[segment_switch_state(switch_states, track[node].num)];
+  } else {
+    next_edge = nextEdge(node);
+  }
   if (next_edge == NULL) return -1;
-  reserving.edges[reserving.len] = next_edge;
-  reserving.len++;
-  reserve_segment_pieces(&reserving, stopdist - next_edge->dist, next_edge->dest->id, false, false, 0);
+  reserving->edges[reserving->len] = next_edge;
+  reserving->len++;
+  if (reserve_segment_pieces(reserving, stopdist - next_edge->dist, next_edge->dest->id, false, false, 0, switch_states) == -1) return -1;
+  return reserving->len;
+}
+
+int reserve_next_segments_offset(path_t *path, int train, int speed, int node, int offset) {
+  reservoir_segment_edges_t reserving;
+  if (next_segments_offset(&reserving, train, speed, node, offset, NULL) == -1) return -1;
 
   int result = RequestSegmentEdgesAndReleaseRest(&reserving);
   if (result == 1) {
@@ -1127,6 +1153,7 @@ void train_controller() {
 
           lastSensor = sensor_data->sensor_no;
           lastSensorTime = sensor_data->timestamp;
+          probe_end(&sensor_data->probe, PROBE_SENSOR_REACTED);
         }
         break;
       case TRAIN_CONTROLLER_COMMAND:
@@ -1135,7 +1162,8 @@ void train_controller() {
         case TRAIN_CONTROLLER_SET_SPEED:
           Logf(EXECUTOR_LOGGING, "TC executing speed cmd");
           lastSpeed = msg->speed;
-          DoCommand(train_speed_task, train, msg->speed);
+          probe_stamp(&msg->probe, PROBE_COMMAND_HANDLED);
+          DoCommandProbed(train_speed_task, train, msg->speed, &msg->probe);
           break;
         case TRAIN_CONTROLLER_CALIBRATE: {
             Logf(EXECUTOR_LOGGING, "TC executing calibrate cmd");
@@ -1178,6 +1206,8 @@ void train_controller() {
         path = navigate_msg->path; // Persist the path
         if (path.len == -1) {
           Logf(PACKET_LOG_INFO, "%d: Broken path!!!", train);
+          // there's no src or dest to go by, so give up on navigating
+          break;
         } else {
           destination = path.dest->id;
         }
@@ -1267,13 +1297,15 @@ static void ensure_train_controller(int train) {
   }
 }
 
-void AlertTrainController(int train, int sensor_no, int timestamp) {
+void AlertTrainController(int train, int sensor_no, int timestamp, latency_probe_t *probe) {
   ensure_train_controller(train);
   Logf(EXECUTOR_LOGGING, "alerting train=%d sensor %4s timestamp=%d tid=%d", train, track[sensor_no].name, timestamp, train_controllers[train]);
   sensor_data_t data;
   data.packet.type = SENSOR_DATA;
   data.sensor_no = sensor_no;
   data.timestamp = timestamp;
+  data.probe = *probe;
+  probe_stamp(&data.probe, PROBE_SENSOR_ALERTED);
   SendSN(train_controllers[train], data);
 }
 
@@ -1283,6 +1315,7 @@ void TellTrainController(int train, int type, int speed) {
   msg.packet.type = TRAIN_CONTROLLER_COMMAND;
   msg.type = type;
   msg.speed = speed;
+  probe_begin(&msg.probe, PROBE_PIPELINE_COMMAND);
   SendSN(train_controllers[train], msg);
 }
 
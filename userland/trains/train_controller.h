@@ -2,6 +2,8 @@
 
 #include <packet.h>
 #include <track/pathing.h>
+#include <latency_probe.h>
+#include <trains/reservoir.h>
 
 typedef struct {
   // type = ROUTE_FAILURE
@@ -23,6 +25,8 @@ typedef struct {
 
   train_command_t type;
   int speed;
+  // PROBE_PIPELINE_COMMAND, only ended for TRAIN_CONTROLLER_SET_SPEED
+  latency_probe_t probe;
 } train_command_msg_t;
 
 typedef struct {
@@ -44,6 +48,27 @@ typedef enum {
  */
 void InitTrainControllers();
 
+/**
+ * Gets the segments ahead of a node which a train needs to be able to stop,
+ * i.e. its stopping distance plus offset, down both sides of the first
+ * branch and along the switches after it
+ * @param  reserving     segments (OUTPUT)
+ * @param  switch_states of every switch, by switch_to_index, or NULL to ask
+ *                       the switch controller at each switch
+ * @return               the number of segments, or -1 if nothing is ahead or
+ *                       there are more than the reservoir takes at once
+ *                       (RESERVING_LIMIT - 1)
+ */
+int next_segments_offset(reservoir_segment_edges_t *reserving, int train, int speed, int node, int offset, const int *switch_states);
+
+/**
+ * Reserves the segments from next_segments_offset, and releases every other
+ * segment the train owns
+ * @return 0 => OK
+ *         -1 => nothing ahead, or the segments are owned by another train
+ */
+int reserve_next_segments_offset(path_t *path, int train, int speed, int node, int offset);
+
 int CreateTrainController(int train);
 
 
@@ -52,8 +77,9 @@ int CreateTrainController(int train);
  * @param train     attributed to trigger
  * @param sensor_no triggered
  * @param timestamp of triggering
+ * @param probe     of the sensor pipeline, ended once the train has reacted
  */
-void AlertTrainController(int train, int sensor_no, int timestamp);
+void AlertTrainController(int train, int sensor_no, int timestamp, latency_probe_t *probe);
 
 
 /**